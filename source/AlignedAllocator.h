@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+namespace dae
+{
+	//std::vector allocator that starts the storage on an Alignment byte boundary, e.g. a cache line
+	template<typename T, size_t Alignment>
+	struct AlignedAllocator
+	{
+		static_assert(Alignment >= alignof(T) && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two that fits T");
+
+		using value_type = T;
+
+		template<typename U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() noexcept = default;
+
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept
+		{
+		}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t{ Alignment }));
+		}
+
+		void deallocate(T* p, size_t) noexcept
+		{
+			::operator delete(p, std::align_val_t{ Alignment });
+		}
+
+		template<typename U>
+		bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+	};
+
+	//Cache line size of current x86 cores
+	constexpr size_t CacheLineSize{ 64 };
+}
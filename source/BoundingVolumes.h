@@ -0,0 +1,120 @@
+#pragma once
+#include "Math.h"
+
+namespace dae
+{
+	struct BoundingBox
+	{
+		Vector3 min{ FLT_MAX, FLT_MAX, FLT_MAX };
+		Vector3 max{ -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void Grow(const Vector3& p)
+		{
+			min = { std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z) };
+			max = { std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z) };
+		}
+
+		Vector3 GetCenter() const { return (min + max) * 0.5f; }
+
+		//Box around the transformed corners, still axis aligned in the new space
+		BoundingBox Transformed(const Matrix& m) const
+		{
+			BoundingBox out{};
+			for (int i{ 0 }; i < 8; ++i)
+			{
+				out.Grow(m.TransformPoint(
+					(i & 1) ? max.x : min.x,
+					(i & 2) ? max.y : min.y,
+					(i & 4) ? max.z : min.z));
+			}
+			return out;
+		}
+	};
+
+	struct BoundingSphere
+	{
+		Vector3 center{};
+		float radius{};
+
+		//Radius grows with the largest axis scale so the sphere stays conservative under non uniform scaling
+		BoundingSphere Transformed(const Matrix& m) const
+		{
+			const float maxScale{ std::max(m.GetAxisX().Magnitude(), std::max(m.GetAxisY().Magnitude(), m.GetAxisZ().Magnitude())) };
+			return { m.TransformPoint(center), radius * maxScale };
+		}
+	};
+
+	struct Plane
+	{
+		Vector3 normal{};
+		float distance{};
+
+		float SignedDistance(const Vector3& p) const { return Vector3::Dot(normal, p) + distance; }
+	};
+
+	//Planes point inwards, a point is inside when it is on the positive side of all of them
+	struct Frustum
+	{
+		enum PlaneIndex { Left, Right, Bottom, Top, Near, Far };
+
+		Plane planes[6]{};
+
+		//Gribb-Hartmann extraction for row vectors and a [0, 1] depth range
+		static Frustum FromViewProjection(const Matrix& viewProjection)
+		{
+			const auto column = [&viewProjection](int c)
+			{
+				return Vector4{ viewProjection[0][c], viewProjection[1][c], viewProjection[2][c], viewProjection[3][c] };
+			};
+
+			const Vector4 column0{ column(0) };
+			const Vector4 column1{ column(1) };
+			const Vector4 column2{ column(2) };
+			const Vector4 column3{ column(3) };
+
+			const Vector4 rawPlanes[6]{
+				column3 + column0,
+				column3 - column0,
+				column3 + column1,
+				column3 - column1,
+				column2,
+				column3 - column2
+			};
+
+			Frustum frustum{};
+			for (int i{ 0 }; i < 6; ++i)
+			{
+				const float length{ Vector3{ rawPlanes[i].x, rawPlanes[i].y, rawPlanes[i].z }.Magnitude() };
+				frustum.planes[i].normal = Vector3{ rawPlanes[i].x, rawPlanes[i].y, rawPlanes[i].z } / length;
+				frustum.planes[i].distance = rawPlanes[i].w / length;
+			}
+			return frustum;
+		}
+
+		bool IsOutside(const BoundingSphere& sphere) const
+		{
+			for (const Plane& plane : planes)
+			{
+				if (plane.SignedDistance(sphere.center) < -sphere.radius)
+					return true;
+			}
+			return false;
+		}
+
+		bool IsOutside(const BoundingBox& box) const
+		{
+			for (const Plane& plane : planes)
+			{
+				//Corner furthest along the plane normal, if even that one is behind the box is
+				const Vector3 positiveCorner{
+					plane.normal.x >= 0.f ? box.max.x : box.min.x,
+					plane.normal.y >= 0.f ? box.max.y : box.min.y,
+					plane.normal.z >= 0.f ? box.max.z : box.min.z };
+
+				if (plane.SignedDistance(positiveCorner) < 0.f)
+					return true;
+			}
+			return false;
+		}
+	};
+}
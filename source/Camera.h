@@ -5,6 +5,7 @@
 
 #include "Math.h"
 #include "Timer.h"
+#include "BoundingVolumes.h"
 
 namespace dae
 {
@@ -50,10 +51,25 @@ namespace dae
 		float totalPitch{};
 		float totalYaw{};
 
+		//State at the start of the last fixed update, used to interpolate the rendered view
+		Vector3 previousOrigin{};
+		float previousPitch{};
+		float previousYaw{};
+
 		Matrix invViewMatrix{};
 		Matrix viewMatrix{};
 		Matrix projectionMatrix{};
 
+		//Cached product of the two above, viewVersion changes whenever it is rebuilt
+		Matrix viewProjectionMatrix{};
+		uint32_t viewVersion{};
+
+		mutable Frustum frustum{};
+		mutable uint32_t frustumVersion{ UINT32_MAX };
+
+		//Set while the view matrices hold an interpolated view instead of the current state
+		bool isViewInterpolated{ false };
+
 
 		const float defaultMouseMoveSpeedSoftware{ 20 };
 		const float defaultMouseMoveSpeedHardware{ 200 };
@@ -70,6 +86,7 @@ namespace dae
 			fov = tanf((fovAngle * TO_RADIANS) / 2.f);
 
 			origin = _origin;
+			previousOrigin = _origin;
 
 			aspectRatio = _aspectRatio;
 
@@ -96,10 +113,31 @@ namespace dae
 			//Inverse(ONB) => ViewMatrix
 			viewMatrix = invViewMatrix.Inverse();
 
+			isViewInterpolated = false;
+			UpdateViewProjection();
+
 			//ViewMatrix => Matrix::CreateLookAtLH(...) [not implemented yet]
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixlookatlh
 		}
 
+		void UpdateViewProjection()
+		{
+			viewProjectionMatrix = viewMatrix * projectionMatrix;
+			++viewVersion;
+		}
+
+		//Frustum of the rendered (interpolated) view, in world space, only rebuilt when the view changed
+		const Frustum& GetFrustum() const
+		{
+			if (frustumVersion != viewVersion)
+			{
+				frustum = Frustum::FromViewProjection(viewProjectionMatrix);
+				frustumVersion = viewVersion;
+			}
+
+			return frustum;
+		}
+
 		void CalculateProjectionMatrix()
 		{
 			//TODO W2
@@ -107,12 +145,53 @@ namespace dae
 			//ProjectionMatrix => Matrix::CreatePerspectiveFovLH(...) [not implemented yet]
 			projectionMatrix = Matrix::CreatePerspectiveFovLH(fov, aspectRatio, nearPlane, farPlane);
 			//DirectX Implementation => https://learn.microsoft.com/en-us/windows/win32/direct3d9/d3dxmatrixperspectivefovlh
+
+			UpdateViewProjection();
 		}
 
 
-		void Update(const Timer* pTimer)
+		void StorePreviousState()
 		{
-			const float deltaTime = pTimer->GetElapsed();
+			previousOrigin = origin;
+			previousPitch = totalPitch;
+			previousYaw = totalYaw;
+		}
+
+		//Rebuilds the view matrices between the previous and current update, leaves the simulated state untouched
+		void Interpolate(float alpha)
+		{
+			//Nothing moved during the last update, the view matrices already hold the current state
+			if (!IsMoving())
+				return;
+
+			const Vector3 renderOrigin{ previousOrigin + (origin - previousOrigin) * alpha };
+			const float renderPitch{ Lerpf(previousPitch, totalPitch, alpha) };
+			const float renderYaw{ Lerpf(previousYaw, totalYaw, alpha) };
+
+			const Matrix rotationMatrix{ Matrix::CreateRotationX(renderPitch * TO_RADIANS) * Matrix::CreateRotationY(renderYaw * TO_RADIANS) };
+
+			const Vector3 renderForward{ rotationMatrix.TransformVector(Vector3::UnitZ) };
+			const Vector3 renderRight{ Vector3::Cross(Vector3::UnitY, renderForward).Normalized() };
+			const Vector3 renderUp{ Vector3::Cross(renderForward, renderRight) };
+
+			invViewMatrix = { renderRight, renderUp, renderForward, renderOrigin };
+			viewMatrix = Matrix::Inverse(invViewMatrix);
+
+			isViewInterpolated = true;
+			UpdateViewProjection();
+		}
+
+		bool IsMoving() const
+		{
+			return origin.x != previousOrigin.x || origin.y != previousOrigin.y || origin.z != previousOrigin.z
+				|| totalPitch != previousPitch || totalYaw != previousYaw;
+		}
+
+		void Update(float deltaTime)
+		{
+			const Vector3 startOrigin{ origin };
+			const float startPitch{ totalPitch };
+			const float startYaw{ totalYaw };
 
 			//Keyboard Input
 			const uint8_t* pKeyboardState = SDL_GetKeyboardState(nullptr);
@@ -180,6 +259,13 @@ namespace dae
 			}
 
 
+			const bool hasRotated{ totalPitch != startPitch || totalYaw != startYaw };
+			const bool hasMoved{ origin.x != startOrigin.x || origin.y != startOrigin.y || origin.z != startOrigin.z };
+
+			//Standing still with up to date matrices, nothing to rebuild
+			if (!hasRotated && !hasMoved && !isViewInterpolated)
+				return;
+
 			const Matrix pitchMatrix{ Matrix::CreateRotationX(totalPitch * TO_RADIANS) };
 			const Matrix yawMatrix{ Matrix::CreateRotationY(totalYaw * TO_RADIANS) };
 			const Matrix rollMatrix{ Matrix::CreateRotationZ(0) };
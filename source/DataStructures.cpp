@@ -26,36 +26,121 @@ namespace dae
 			m_pVertexBuffer->Release();
 		if (m_pInputLayout)
 			m_pInputLayout->Release();
+		if (m_pInstanceBuffer)
+			m_pInstanceBuffer->Release();
+		if (m_pInstancedInputLayout)
+			m_pInstancedInputLayout->Release();
 	}
 
-	void Mesh::Render(ID3D11DeviceContext* pDeviceContext, Matrix worldViewProj, Matrix invView) const
+	void Mesh::Render(ID3D11DeviceContext* pDeviceContext, const Matrix& viewProjection, uint32_t viewProjectionVersion, const Matrix& invView) const
 	{
-
-		m_pEffect->SetWorldViewProjMatrixData(worldViewProj);
-		m_pEffect->SetWorldMatrixData(m_WorldMatrix);
 		m_pEffect->SetInvViewMatrixData(invView);
 
 		pDeviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
+		pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+		//Shared geometry in slot 0, instance matrices in slot 1, all instances in a single draw
+		if (m_pInstanceBuffer)
+		{
+			m_pEffect->SetWorldMatrixData(GetRenderWorldMatrix());
+			m_pEffect->SetViewProjMatrixData(viewProjection);
+
+			pDeviceContext->IASetInputLayout(m_pInstancedInputLayout);
+
+			ID3D11Buffer* const pBuffers[]{ m_pVertexBuffer, m_pInstanceBuffer };
+			constexpr UINT strides[]{ sizeof(Vertex_In), sizeof(Matrix) };
+			constexpr UINT offsets[]{ 0, 0 };
+			pDeviceContext->IASetVertexBuffers(0, 2, pBuffers, strides, offsets);
+
+			DrawPasses(pDeviceContext, m_pEffect->GetInstancedTechnique(), GetNrInstances());
+			return;
+		}
+
 		pDeviceContext->IASetInputLayout(m_pInputLayout);
 
 		constexpr UINT stride{ sizeof(Vertex_In) };
 		constexpr UINT offset{};
 		pDeviceContext->IASetVertexBuffers(0, 1, &m_pVertexBuffer, &stride, &offset);
 
-		pDeviceContext->IASetIndexBuffer(m_pIndexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		if (m_InstanceMatrices.empty())
+		{
+			m_pEffect->SetWorldViewProjMatrixData(GetWorldViewProjectionMatrix(viewProjection, viewProjectionVersion));
+			m_pEffect->SetWorldMatrixData(GetRenderWorldMatrix());
+			DrawPasses(pDeviceContext, m_pEffect->GetTechnique(), 0);
+			return;
+		}
 
+		//Effect without an instanced technique, same buffers but one draw per instance
+		for (uint32_t instance{}; instance < GetNrInstances(); ++instance)
+		{
+			const Matrix worldMatrix{ GetInstanceWorldMatrix(instance) };
+			m_pEffect->SetWorldViewProjMatrixData(worldMatrix * viewProjection);
+			m_pEffect->SetWorldMatrixData(worldMatrix);
+			DrawPasses(pDeviceContext, m_pEffect->GetTechnique(), 0);
+		}
+	}
 
+	void Mesh::DrawPasses(ID3D11DeviceContext* pDeviceContext, ID3DX11EffectTechnique* pTechnique, uint32_t nrInstances) const
+	{
 		D3DX11_TECHNIQUE_DESC techniqueDesc{};
-		m_pEffect->GetTechnique()->GetDesc(&techniqueDesc);
+		pTechnique->GetDesc(&techniqueDesc);
 		for (UINT p{}; p < techniqueDesc.Passes; ++p)
 		{
-			m_pEffect->GetTechnique()->GetPassByIndex(p)->Apply(0, pDeviceContext);
-			pDeviceContext->DrawIndexed(m_NumIndices, 0, 0);
+			pTechnique->GetPassByIndex(p)->Apply(0, pDeviceContext);
+			if (nrInstances > 0)
+				pDeviceContext->DrawIndexedInstanced(m_NumIndices, nrInstances, 0, 0, 0);
+			else
+				pDeviceContext->DrawIndexed(m_NumIndices, 0, 0);
 		}
 	}
 
-	
+	void Mesh::SetInstances(ID3D11Device* pDevice, const std::vector<Matrix>& instanceMatrices)
+	{
+		m_InstanceMatrices = instanceMatrices;
+
+		if (m_pInstanceBuffer)
+		{
+			m_pInstanceBuffer->Release();
+			m_pInstanceBuffer = nullptr;
+		}
+
+		if (m_InstanceMatrices.empty())
+			return;
+
+		if (m_pInstancedInputLayout)
+		{
+			D3D11_BUFFER_DESC bd{};
+			bd.Usage = D3D11_USAGE_IMMUTABLE;
+			bd.ByteWidth = sizeof(Matrix) * static_cast<uint32_t>(m_InstanceMatrices.size());
+			bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+			bd.CPUAccessFlags = 0;
+			bd.MiscFlags = 0;
+
+			D3D11_SUBRESOURCE_DATA initData{};
+			initData.pSysMem = m_InstanceMatrices.data();
+
+			const HRESULT result{ pDevice->CreateBuffer(&bd, &initData, &m_pInstanceBuffer) };
+			if (FAILED(result))
+				m_pInstanceBuffer = nullptr;
+		}
+
+		//Shader.fx and Transparency.fx have no InstancedTechnique yet, so this is the usual hardware path
+		static bool hasLoggedFallback{ false };
+		if (!m_pInstanceBuffer && !hasLoggedFallback)
+		{
+			hasLoggedFallback = true;
+			std::wcout << L"No instanced technique, instances are drawn with one call each\n";
+		}
+	}
+
+	Matrix Mesh::GetInstanceWorldMatrix(uint32_t instance) const
+	{
+		if (m_InstanceMatrices.empty())
+			return GetRenderWorldMatrix();
+
+		return m_InstanceMatrices[instance] * GetRenderWorldMatrix();
+	}
 
 	void Mesh::SetSampleState(ID3D11SamplerState* pSampler)
 	{
@@ -67,20 +152,69 @@ namespace dae
 		m_pEffect->SetRasterizerState(pRasterizer);
 	}
 
-	Matrix Mesh::GetWorldMatrix() const
+	void Mesh::StorePreviousState()
 	{
-		return m_WorldMatrix;
+		m_Transform.StorePreviousState();
 	}
 
-	void Mesh::SetWorldMatrix(const Matrix& worldMatrix)
+	void Mesh::Interpolate(float alpha)
 	{
+		m_Transform.Interpolate(alpha);
+	}
 
-		m_WorldMatrix = worldMatrix;
+	const Matrix& Mesh::GetWorldViewProjectionMatrix(const Matrix& viewProjection, uint32_t viewProjectionVersion) const
+	{
+		if (m_CachedRenderVersion != m_Transform.GetRenderVersion() || m_CachedViewProjectionVersion != viewProjectionVersion)
+		{
+			m_WorldViewProjectionMatrix = GetRenderWorldMatrix() * viewProjection;
+			m_CachedRenderVersion = m_Transform.GetRenderVersion();
+			m_CachedViewProjectionVersion = viewProjectionVersion;
+		}
+
+		return m_WorldViewProjectionMatrix;
 	}
 
 	void Mesh::RotateMesh(float rotation)
 	{
-		m_WorldMatrix = Matrix::CreateRotationY(rotation) * m_WorldMatrix;
+		//Accumulated as an angle instead of multiplying matrices, so no drift builds up over time
+		m_Transform.Rotate({ 0.f, rotation, 0.f });
+	}
+
+	bool Mesh::IsOutsideFrustum(const Frustum& frustum) const
+	{
+		//Culled only when every instance is outside
+		for (uint32_t instance{}; instance < GetNrInstances(); ++instance)
+		{
+			if (!IsOutsideFrustum(frustum, GetInstanceWorldMatrix(instance)))
+				return false;
+		}
+
+		return true;
+	}
+
+	bool Mesh::IsOutsideFrustum(const Frustum& frustum, const Matrix& worldMatrix) const
+	{
+		//Cheap sphere test first, the box is tighter for long thin meshes
+		if (frustum.IsOutside(m_BoundingSphere.Transformed(worldMatrix)))
+			return true;
+
+		return frustum.IsOutside(m_BoundingBox.Transformed(worldMatrix));
+	}
+
+	void Mesh::CalculateBounds()
+	{
+		m_BoundingBox = {};
+		for (const Vertex_In& vertex : m_VerticesIn)
+		{
+			m_BoundingBox.Grow(vertex.position);
+		}
+
+		m_BoundingSphere.center = m_BoundingBox.GetCenter();
+		m_BoundingSphere.radius = 0.f;
+		for (const Vertex_In& vertex : m_VerticesIn)
+		{
+			m_BoundingSphere.radius = std::max(m_BoundingSphere.radius, Vector3{ m_BoundingSphere.center, vertex.position }.Magnitude());
+		}
 	}
 
 	void Mesh::InitHardware(ID3D11Device* pDevice)
@@ -126,6 +260,8 @@ namespace dae
 			) };
 		if (FAILED(result)) return;
 
+		InitInstancedInputLayout(pDevice, vertexDesc, numElements);
+
 		D3D11_BUFFER_DESC bd{};
 		bd.Usage = D3D11_USAGE_IMMUTABLE;
 		bd.ByteWidth = sizeof(Vertex_In) * static_cast<uint32_t>(m_VerticesIn.size());
@@ -153,10 +289,158 @@ namespace dae
 
 	}
 
+	void Mesh::InitInstancedInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pVertexDesc, uint32_t nrVertexElements)
+	{
+		ID3DX11EffectTechnique* pTechnique{ m_pEffect->GetInstancedTechnique() };
+		if (!pTechnique)
+			return;
+
+		//The vertex elements followed by the instance matrix as four float4 rows
+		static constexpr uint32_t nrInstanceElements{ 4 };
+		std::vector<D3D11_INPUT_ELEMENT_DESC> instancedDesc(pVertexDesc, pVertexDesc + nrVertexElements);
+		for (uint32_t row{}; row < nrInstanceElements; ++row)
+		{
+			D3D11_INPUT_ELEMENT_DESC element{};
+			element.SemanticName = "INSTANCE";
+			element.SemanticIndex = row;
+			element.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+			element.InputSlot = 1;
+			element.AlignedByteOffset = row * sizeof(Vector4);
+			element.InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+			element.InstanceDataStepRate = 1;
+			instancedDesc.push_back(element);
+		}
+
+		D3DX11_PASS_DESC passDesc{};
+		pTechnique->GetPassByIndex(0)->GetDesc(&passDesc);
+
+		const HRESULT result{ pDevice->CreateInputLayout
+			(
+				instancedDesc.data(),
+				static_cast<uint32_t>(instancedDesc.size()),
+				passDesc.pIAInputSignature,
+				passDesc.IAInputSignatureSize,
+				&m_pInstancedInputLayout
+			) };
+		if (FAILED(result))
+			m_pInstancedInputLayout = nullptr;
+	}
+
 	void Mesh::InitSoftware(const std::vector<Vertex_In>& vertices, const std::vector<uint32_t>& indices)
 	{
 		m_VerticesIn = vertices;
 		m_Indices = indices;
+
+		CalculateBounds();
+		BuildMeshlets();
+	}
+
+	void Mesh::BuildMeshlets()
+	{
+		m_Meshlets.clear();
+		if (m_PrimitiveTopology != PrimitiveTopology::TriangleList)
+			return;
+
+		//Greedy in index order, a meshlet is a contiguous run of triangles so no index remapping is needed
+		std::vector<uint32_t> vertexMeshlet(m_VerticesIn.size(), UINT32_MAX);
+
+		uint32_t meshletStart{};
+		uint32_t nrTriangles{};
+		uint32_t nrVertices{};
+		uint32_t meshletId{};
+
+		for (uint32_t i{}; i + 2 < m_Indices.size(); i += 3)
+		{
+			uint32_t nrNewVertices{};
+			for (uint32_t v{}; v < 3; ++v)
+			{
+				if (vertexMeshlet[m_Indices[i + v]] != meshletId)
+					++nrNewVertices;
+			}
+
+			if (nrTriangles == MaxMeshletTriangles || nrVertices + nrNewVertices > MaxMeshletVertices)
+			{
+				m_Meshlets.push_back(MakeMeshlet(meshletStart, nrTriangles));
+
+				meshletStart = i;
+				nrTriangles = 0;
+				nrVertices = 0;
+				++meshletId;
+			}
+
+			for (uint32_t v{}; v < 3; ++v)
+			{
+				uint32_t& owner{ vertexMeshlet[m_Indices[i + v]] };
+				if (owner != meshletId)
+				{
+					owner = meshletId;
+					++nrVertices;
+				}
+			}
+			++nrTriangles;
+		}
+
+		if (nrTriangles > 0)
+		{
+			m_Meshlets.push_back(MakeMeshlet(meshletStart, nrTriangles));
+		}
+	}
+
+	Meshlet Mesh::MakeMeshlet(uint32_t firstIndex, uint32_t nrTriangles) const
+	{
+		Meshlet meshlet{ firstIndex, nrTriangles };
+
+		BoundingBox box{};
+		for (uint32_t i{ firstIndex }; i < firstIndex + nrTriangles * 3; ++i)
+		{
+			box.Grow(m_VerticesIn[m_Indices[i]].position);
+		}
+
+		meshlet.bounds.center = box.GetCenter();
+		for (uint32_t i{ firstIndex }; i < firstIndex + nrTriangles * 3; ++i)
+		{
+			meshlet.bounds.radius = std::max(meshlet.bounds.radius, Vector3{ meshlet.bounds.center, m_VerticesIn[m_Indices[i]].position }.Magnitude());
+		}
+
+		//Face normals from the index winding, the same winding the rasterizer culls by
+		std::vector<Vector3> faceNormals{};
+		faceNormals.reserve(nrTriangles);
+
+		Vector3 axis{};
+		for (uint32_t i{ firstIndex }; i < firstIndex + nrTriangles * 3; i += 3)
+		{
+			const Vertex_In& v0{ m_VerticesIn[m_Indices[i]] };
+			const Vertex_In& v1{ m_VerticesIn[m_Indices[i + 1]] };
+			const Vertex_In& v2{ m_VerticesIn[m_Indices[i + 2]] };
+
+			Vector3 faceNormal{ Vector3::Cross(v1.position - v0.position, v2.position - v0.position) };
+			if (faceNormal.SqrMagnitude() <= FLT_EPSILON)
+				continue;
+
+			faceNormal.Normalize();
+			faceNormals.push_back(faceNormal);
+			axis += faceNormal;
+		}
+
+		if (faceNormals.empty() || axis.SqrMagnitude() <= FLT_EPSILON)
+			return meshlet;
+
+		axis.Normalize();
+
+		float minDot{ 1.f };
+		for (const Vector3& faceNormal : faceNormals)
+		{
+			minDot = std::min(minDot, Vector3::Dot(axis, faceNormal));
+		}
+
+		//Conservative like meshoptimizer, a cone this wide rarely culls and its cutoff is sensitive to float error
+		constexpr float MinConeDot{ 0.1f };
+		if (minDot <= MinConeDot)
+			return meshlet;
+
+		meshlet.coneAxis = axis;
+		meshlet.coneCutoff = sqrtf(1.f - minDot * minDot);
+		return meshlet;
 	}
 
 
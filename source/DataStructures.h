@@ -1,12 +1,16 @@
 #pragma once
 #include "Vector3.h"
 #include "ColorRGB.h"
+#include "BoundingVolumes.h"
+#include "Transform.h"
 #include <d3dx11effect.h>
+#include <memory>
 
 namespace dae
 {
 	class Effect;
 	class Texture;
+	class MaterialTexture;
 
 
 	struct Vertex_In
@@ -35,6 +39,45 @@ namespace dae
 		TriangleStrip
 	};
 
+	//Cluster of neighbouring triangles that is culled as a whole before any per triangle work
+	struct Meshlet
+	{
+		uint32_t firstIndex{};
+		uint32_t nrTriangles{};
+		BoundingSphere bounds{};
+
+		//Normals of all triangles lie within the cone, a cutoff of 1 means the cone is too wide to ever cull
+		Vector3 coneAxis{};
+		float coneCutoff{ 1.f };
+	};
+
+	//Adaptive uses the renderer's per tile rate image, the others force a rate for the whole mesh
+	enum class ShadingRate
+	{
+		Adaptive,
+		Rate1x1,
+		Rate2x1,
+		Rate2x2,
+		Rate4x4
+	};
+
+	//Textures a mesh is shaded with in the software path, shared through the renderer's texture cache
+	struct Material
+	{
+		std::shared_ptr<Texture> pDiffuseMap{};
+		std::shared_ptr<Texture> pNormalMap{};
+		std::shared_ptr<Texture> pSpecularMap{};
+		std::shared_ptr<Texture> pGlossinessMap{};
+
+		//Owned, the maps above interleaved into one texel when the material has several of them, baked by the creator
+		MaterialTexture* pPackedMaps{};
+
+		bool isTransparent{ false };
+
+		//Index in the renderer's material list, used to group draws
+		uint16_t id{};
+	};
+
 	class Mesh final
 	{
 	public:
@@ -46,25 +89,62 @@ namespace dae
 		Mesh(Mesh&& other) = delete;
 		Mesh& operator=(Mesh&& other) = delete;
 
-		void Render(ID3D11DeviceContext* pDeviceContext, Matrix worldView, Matrix invView) const;
+		void Render(ID3D11DeviceContext* pDeviceContext, const Matrix& viewProjection, uint32_t viewProjectionVersion, const Matrix& invView) const;
 
 		void SetSampleState(ID3D11SamplerState* pSampler);
 		void SetRasterizerState(ID3D11RasterizerState* pRasterizer);
 
-		Matrix GetWorldMatrix() const;
-		void  SetWorldMatrix(const Matrix& m_WorldMatrix);
+		Transform& GetTransform() { return m_Transform; };
+		const Transform& GetTransform() const { return m_Transform; };
+
+		//World matrix interpolated between the last two fixed updates, this is what gets rendered
+		const Matrix& GetRenderWorldMatrix() const { return m_Transform.GetRenderMatrix(); };
+		void StorePreviousState();
+		void Interpolate(float alpha);
+
+		//Only rebuilt when the rendered world matrix or the view projection changed
+		const Matrix& GetWorldViewProjectionMatrix(const Matrix& viewProjection, uint32_t viewProjectionVersion) const;
+
+		//Per instance matrices, applied before the mesh transform. Without instances the mesh is drawn once
+		void SetInstances(ID3D11Device* pDevice, const std::vector<Matrix>& instanceMatrices);
+		const std::vector<Matrix>& GetInstances() const { return m_InstanceMatrices; };
+		uint32_t GetNrInstances() const { return std::max(static_cast<uint32_t>(m_InstanceMatrices.size()), 1u); };
+		Matrix GetInstanceWorldMatrix(uint32_t instance) const;
 
 		void RotateMesh(float rotation);
 
+		//Object space bounds, computed once at construction
+		const BoundingBox& GetBoundingBox() const { return m_BoundingBox; };
+		const BoundingSphere& GetBoundingSphere() const { return m_BoundingSphere; };
+		bool IsOutsideFrustum(const Frustum& frustum) const;
+		bool IsOutsideFrustum(const Frustum& frustum, const Matrix& worldMatrix) const;
+
+		//Only built for triangle lists
+		const std::vector<Meshlet>& GetMeshlets() const { return m_Meshlets; };
+
+		static constexpr uint32_t MaxMeshletVertices{ 64 };
+		static constexpr uint32_t MaxMeshletTriangles{ 124 };
+
+
+		const Material* GetMaterial() const { return m_pMaterial; };
+		void SetMaterial(const Material* pMaterial) { m_pMaterial = pMaterial; };
 
 		PrimitiveTopology GetPrimitiveTopoligy() const { return m_PrimitiveTopology; };
-		std::vector<Vertex_In> GetVerticesIn() const { return m_VerticesIn; };
+		ShadingRate GetShadingRate() const { return m_ShadingRate; };
+		void SetShadingRate(ShadingRate shadingRate) { m_ShadingRate = shadingRate; };
+		const std::vector<Vertex_In>& GetVerticesIn() const { return m_VerticesIn; };
 		std::vector<Vertex_Out>& GetVerticesOutReference() { return m_VerticesOut; };
-		std::vector<uint32_t> GetIndeces() const { return m_Indices; };
+		const std::vector<uint32_t>& GetIndeces() const { return m_Indices; };
 
 	private:
 		//SHARED
-		Matrix m_WorldMatrix{};
+		Transform m_Transform{};
+
+		mutable Matrix m_WorldViewProjectionMatrix{};
+		mutable uint32_t m_CachedRenderVersion{ UINT32_MAX };
+		mutable uint32_t m_CachedViewProjectionVersion{ UINT32_MAX };
+
+		std::vector<Matrix> m_InstanceMatrices{};
 
 		//HARDWARE
 		Effect* m_pEffect{};
@@ -76,15 +156,31 @@ namespace dae
 		uint32_t m_NumIndices{};
 		ID3D11Buffer* m_pIndexBuffer{};
 
+		//Only created when the effect has an instanced technique, one matrix per instance in slot 1
+		ID3D11InputLayout* m_pInstancedInputLayout{};
+		ID3D11Buffer* m_pInstanceBuffer{};
+
 
 		void InitHardware(ID3D11Device* pDevice);
+		void InitInstancedInputLayout(ID3D11Device* pDevice, const D3D11_INPUT_ELEMENT_DESC* pVertexDesc, uint32_t nrVertexElements);
+		void DrawPasses(ID3D11DeviceContext* pDeviceContext, ID3DX11EffectTechnique* pTechnique, uint32_t nrInstances) const;
 
 		//SOFTWARE
 		std::vector<Vertex_In> m_VerticesIn{};
 		std::vector<uint32_t> m_Indices{};
 		PrimitiveTopology m_PrimitiveTopology{ PrimitiveTopology::TriangleList };
+		ShadingRate m_ShadingRate{ ShadingRate::Adaptive };
+		const Material* m_pMaterial{};
 		std::vector<Vertex_Out> m_VerticesOut{};
 
+		BoundingBox m_BoundingBox{};
+		BoundingSphere m_BoundingSphere{};
+
+		std::vector<Meshlet> m_Meshlets{};
+
+		void CalculateBounds();
+		void BuildMeshlets();
+		Meshlet MakeMeshlet(uint32_t firstIndex, uint32_t nrTriangles) const;
 		void InitSoftware(const std::vector<Vertex_In>& vertices, const std::vector<uint32_t>& indices);
 	};
 }
@@ -10,11 +10,19 @@ namespace dae
 #pragma region Techniques
 		m_pRenderTechnique = m_pEffect->GetTechniqueByName("RenderTechnique");
 		if (!m_pRenderTechnique->IsValid()) std::wcout << L"Technique not valid\n";
+
+		//Optional, instances fall back to one draw call each without it
+		m_pInstancedTechnique = m_pEffect->GetTechniqueByName("InstancedTechnique");
+		if (!m_pInstancedTechnique->IsValid()) m_pInstancedTechnique = nullptr;
 #pragma endregion
 
 #pragma region Matrix
 		m_pMatWorldViewProjVariable = m_pEffect->GetVariableByName("gWorldViewProj")->AsMatrix();
 		if (!m_pMatWorldViewProjVariable->IsValid()) std::wcout << L"WorldViewProj not valid\n";
+
+		//Only used by the instanced technique
+		m_pMatViewProjVariable = m_pEffect->GetVariableByName("gViewProj")->AsMatrix();
+		if (!m_pMatViewProjVariable->IsValid()) m_pMatViewProjVariable = nullptr;
 #pragma endregion
 
 #pragma region Shaders
@@ -48,6 +56,11 @@ namespace dae
 		return m_pRenderTechnique;
 	}
 
+	ID3DX11EffectTechnique* Effect::GetInstancedTechnique() const
+	{
+		return m_pInstancedTechnique;
+	}
+
 	void Effect::SetWorldViewProjMatrixData(Matrix pWorldViewProjectionMatrix)
 	{
 		m_pMatWorldViewProjVariable->SetMatrix(reinterpret_cast<const float*>(&pWorldViewProjectionMatrix));
@@ -59,6 +72,12 @@ namespace dae
 		m_pMatWorldMatrixVariable->SetMatrix(reinterpret_cast<const float*>(&worldMatrix));
 	}
 
+	void Effect::SetViewProjMatrixData(Matrix viewProjectionMatrix)
+	{
+		if (m_pMatViewProjVariable)
+			m_pMatViewProjVariable->SetMatrix(reinterpret_cast<const float*>(&viewProjectionMatrix));
+	}
+
 	void dae::Effect::SetInvViewMatrixData(Matrix invViewMatrix)
 	{
 		if(m_pMatInvViewMatrixVariable)
@@ -17,9 +17,12 @@ namespace dae
 
 		ID3DX11Effect* GetEffect() const;
 		ID3DX11EffectTechnique* GetTechnique() const;
+		//Nullptr when the effect file has no instanced technique
+		ID3DX11EffectTechnique* GetInstancedTechnique() const;
 
 		void SetWorldViewProjMatrixData(Matrix worldViewProjectionMatrix);
 		void SetWorldMatrixData(Matrix worldMatrix);
+		void SetViewProjMatrixData(Matrix viewProjectionMatrix);
 		void SetInvViewMatrixData(Matrix invViewMatrix);
 
 		void SetDiffuseMap(Texture* pTexture);
@@ -32,9 +35,11 @@ namespace dae
 
 		ID3DX11Effect* m_pEffect{};
 		ID3DX11EffectTechnique* m_pRenderTechnique{};
+		ID3DX11EffectTechnique* m_pInstancedTechnique{};
 
 		ID3DX11EffectMatrixVariable* m_pMatWorldViewProjVariable{};
 		ID3DX11EffectMatrixVariable* m_pMatWorldMatrixVariable{};
+		ID3DX11EffectMatrixVariable* m_pMatViewProjVariable{};
 		ID3DX11EffectMatrixVariable* m_pMatInvViewMatrixVariable{};
 
 		ID3DX11EffectRasterizerVariable* m_pRasterizer;
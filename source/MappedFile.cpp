@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "MappedFile.h"
+#include <windows.h>
+
+namespace dae
+{
+	MappedFile::~MappedFile()
+	{
+		if (m_pData)
+			UnmapViewOfFile(m_pData);
+		if (m_MappingHandle)
+			CloseHandle(m_MappingHandle);
+		if (m_FileHandle && m_FileHandle != INVALID_HANDLE_VALUE)
+			CloseHandle(m_FileHandle);
+	}
+
+	MappedFile* MappedFile::Open(const std::string& path)
+	{
+		MappedFile* pMappedFile{ new MappedFile{} };
+
+		pMappedFile->m_FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER fileSize{};
+		if (pMappedFile->m_FileHandle == INVALID_HANDLE_VALUE || !GetFileSizeEx(pMappedFile->m_FileHandle, &fileSize) || fileSize.QuadPart == 0)
+		{
+			delete pMappedFile;
+			return nullptr;
+		}
+
+		pMappedFile->m_MappingHandle = CreateFileMappingA(pMappedFile->m_FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!pMappedFile->m_MappingHandle)
+		{
+			delete pMappedFile;
+			return nullptr;
+		}
+
+		pMappedFile->m_pData = static_cast<const uint8_t*>(MapViewOfFile(pMappedFile->m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+		if (!pMappedFile->m_pData)
+		{
+			delete pMappedFile;
+			return nullptr;
+		}
+
+		pMappedFile->m_Size = static_cast<size_t>(fileSize.QuadPart);
+		pMappedFile->m_Path = path;
+		return pMappedFile;
+	}
+}
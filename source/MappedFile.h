@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+
+namespace dae
+{
+	//Read only view of a whole file, pages are loaded on first touch and shared with every process mapping the same file
+	class MappedFile final
+	{
+	public:
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile(MappedFile&&) noexcept = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		MappedFile& operator=(MappedFile&&) noexcept = delete;
+
+		//Nullptr when the file does not exist or is empty
+		static MappedFile* Open(const std::string& path);
+
+		const uint8_t* GetData() const { return m_pData; };
+		size_t GetSize() const { return m_Size; };
+		const std::string& GetPath() const { return m_Path; };
+
+	private:
+		MappedFile() = default;
+
+		void* m_FileHandle{};
+		void* m_MappingHandle{};
+		const uint8_t* m_pData{};
+		size_t m_Size{};
+		std::string m_Path{};
+	};
+}
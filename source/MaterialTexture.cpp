@@ -0,0 +1,230 @@
+#include "pch.h"
+#include "MaterialTexture.h"
+#include "DataStructures.h"
+#include "Vector2.h"
+#include "TextureFilter.h"
+
+namespace dae
+{
+	namespace
+	{
+		constexpr float ToFloat{ 1.f / 255.f };
+
+		uint64_t ToByte(float value)
+		{
+			return static_cast<uint64_t>(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f);
+		}
+	}
+
+	MaterialTexture::MaterialTexture(int width, int height)
+	{
+		//Sizes of the whole chain first, so the storage is allocated once
+		size_t nrTexels{};
+		while (true)
+		{
+			const int blocksPerRow{ (width + BlockSize - 1) / BlockSize };
+			const int blocksPerColumn{ (height + BlockSize - 1) / BlockSize };
+			const bool isPowerOfTwo{ (width & (width - 1)) == 0 && (height & (height - 1)) == 0 };
+			m_MipLevels.push_back({ nullptr, width, height, blocksPerRow, isPowerOfTwo, width - 1, height - 1 });
+			nrTexels += static_cast<size_t>(blocksPerRow) * blocksPerColumn * BlockSize * BlockSize;
+
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		m_TexelStorage.resize(nrTexels);
+
+		size_t offset{};
+		for (MipLevel& level : m_MipLevels)
+		{
+			level.pTexels = m_TexelStorage.data() + offset;
+			const int blocksPerColumn{ (level.height + BlockSize - 1) / BlockSize };
+			offset += static_cast<size_t>(level.blocksPerRow) * blocksPerColumn * BlockSize * BlockSize;
+		}
+	}
+
+	MaterialTexture* MaterialTexture::Bake(const Material& material)
+	{
+		const int nrMaps{ (material.pDiffuseMap != nullptr) + (material.pNormalMap != nullptr)
+			+ (material.pGlossinessMap != nullptr) + (material.pSpecularMap != nullptr) };
+		if (!material.pDiffuseMap || nrMaps < 2 || material.isTransparent)
+			return nullptr;
+
+		//Baked at the diffuse resolution, the other maps are resampled at the same texel centers
+		MaterialTexture* pPacked{ new MaterialTexture{ material.pDiffuseMap->GetWidth(), material.pDiffuseMap->GetHeight() } };
+		pPacked->m_HasNormalMap = material.pNormalMap != nullptr;
+		pPacked->m_HasSpecular = material.pSpecularMap && material.pGlossinessMap;
+
+		//Eight texel centers of a row at a time through the batched sampler, missing maps bake to neutral values
+		constexpr int NrLanes{ 8 };
+		const MipLevel& topLevel{ pPacked->m_MipLevels.front() };
+		for (int y{}; y < topLevel.height; ++y)
+		{
+			for (int startX{}; startX < topLevel.width; startX += NrLanes)
+			{
+				float u[NrLanes];
+				float v[NrLanes];
+				for (int lane{}; lane < NrLanes; ++lane)
+				{
+					//Lanes past the end of the row repeat the last texel and are not written
+					u[lane] = (std::min(startX + lane, topLevel.width - 1) + 0.5f) / topLevel.width;
+					v[lane] = (y + 0.5f) / topLevel.height;
+				}
+
+				float diffuse[3][NrLanes];
+				float glossiness[3][NrLanes]{};
+				float normal[3][NrLanes];
+				float specular[3][NrLanes]{};
+				std::fill_n(normal[0], NrLanes, 0.5f);
+				std::fill_n(normal[1], NrLanes, 0.5f);
+
+				material.pDiffuseMap->Sample8(u, v, diffuse[0], diffuse[1], diffuse[2]);
+				if (material.pGlossinessMap)
+					material.pGlossinessMap->Sample8(u, v, glossiness[0], glossiness[1], glossiness[2]);
+				if (material.pNormalMap)
+					material.pNormalMap->Sample8(u, v, normal[0], normal[1], normal[2]);
+				if (material.pSpecularMap)
+					material.pSpecularMap->Sample8(u, v, specular[0], specular[1], specular[2]);
+
+				const int nrLanes{ std::min(NrLanes, topLevel.width - startX) };
+				for (int lane{}; lane < nrLanes; ++lane)
+				{
+					pPacked->TexelAt(topLevel, startX + lane, y) =
+						ToByte(diffuse[0][lane]) | ToByte(diffuse[1][lane]) << 8 | ToByte(diffuse[2][lane]) << 16 | ToByte(glossiness[0][lane]) << 24 |
+						ToByte(normal[0][lane]) << 32 | ToByte(normal[1][lane]) << 40 | ToByte(specular[0][lane]) << 48;
+				}
+			}
+		}
+
+		pPacked->BuildMipChain();
+		return pPacked;
+	}
+
+	void MaterialTexture::BuildMipChain()
+	{
+		//2x2 box filter of the level above per channel, odd sizes repeat their last row or column
+		for (size_t i{ 1 }; i < m_MipLevels.size(); ++i)
+		{
+			const MipLevel& source{ m_MipLevels[i - 1] };
+			const MipLevel& destination{ m_MipLevels[i] };
+
+			for (int y{}; y < destination.height; ++y)
+			{
+				const int y0{ std::min(y * 2, source.height - 1) };
+				const int y1{ std::min(y * 2 + 1, source.height - 1) };
+
+				for (int x{}; x < destination.width; ++x)
+				{
+					const int x0{ std::min(x * 2, source.width - 1) };
+					const int x1{ std::min(x * 2 + 1, source.width - 1) };
+
+					const uint64_t texels[4]{ TexelAt(source, x0, y0), TexelAt(source, x1, y0), TexelAt(source, x0, y1), TexelAt(source, x1, y1) };
+
+					uint64_t averaged{};
+					for (int channel{}; channel < NrChannels; ++channel)
+					{
+						const int shift{ channel * 8 };
+						uint64_t sum{ 2 };
+						for (uint64_t texel : texels)
+						{
+							sum += (texel >> shift) & 0xFF;
+						}
+						averaged |= (sum / 4) << shift;
+					}
+
+					TexelAt(destination, x, y) = averaged;
+				}
+			}
+		}
+	}
+
+	uint64_t& MaterialTexture::TexelAt(const MipLevel& level, int x, int y) const
+	{
+		const int blockIndex{ (y >> 2) * level.blocksPerRow + (x >> 2) };
+		return level.pTexels[(blockIndex << 4) + ((y & 3) << 2) + (x & 3)];
+	}
+
+	uint64_t MaterialTexture::FetchTexel(const MipLevel& level, int x, int y) const
+	{
+		//Wraps instead of reading outside the texture for uvs outside [0, 1]
+		if (level.isPowerOfTwo)
+		{
+			x &= level.widthMask;
+			y &= level.heightMask;
+		}
+		else
+		{
+			x = ((x % level.width) + level.width) % level.width;
+			y = ((y % level.height) + level.height) % level.height;
+		}
+		return TexelAt(level, x, y);
+	}
+
+	MaterialTexture::Channels MaterialTexture::Unpack(uint64_t texel)
+	{
+		Channels channels{};
+		for (int channel{}; channel < NrChannels; ++channel)
+		{
+			channels.values[channel] = ((texel >> (channel * 8)) & 0xFF) * ToFloat;
+		}
+		return channels;
+	}
+
+	MaterialTexture::Channels MaterialTexture::Channels::Lerp(const Channels& a, const Channels& b, float factor)
+	{
+		Channels channels{};
+		for (int channel{}; channel < NrChannels; ++channel)
+		{
+			channels.values[channel] = Lerpf(a.values[channel], b.values[channel], factor);
+		}
+		return channels;
+	}
+
+	MaterialTexture::Channels& MaterialTexture::Channels::operator+=(const Channels& other)
+	{
+		for (int channel{}; channel < NrChannels; ++channel)
+		{
+			values[channel] += other.values[channel];
+		}
+		return *this;
+	}
+
+	MaterialTexture::Channels MaterialTexture::Channels::operator/(float divisor) const
+	{
+		Channels channels{};
+		for (int channel{}; channel < NrChannels; ++channel)
+		{
+			channels.values[channel] = values[channel] / divisor;
+		}
+		return channels;
+	}
+
+	MaterialSample MaterialTexture::Decode(const Channels& channels) const
+	{
+		const float* values{ channels.values };
+
+		MaterialSample sample{};
+		sample.diffuse = { values[0], values[1], values[2] };
+		sample.glossiness = values[3];
+		sample.specular = values[6];
+
+		if (m_HasNormalMap)
+		{
+			const float x{ 2.f * values[4] - 1.f };
+			const float y{ 2.f * values[5] - 1.f };
+			sample.normal = { x, y, std::sqrt(std::max(1.f - x * x - y * y, 0.f)) };
+		}
+
+		return sample;
+	}
+
+	MaterialSample MaterialTexture::Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, SampleState sampleState) const
+	{
+		//Every level is always resident, there is nothing to request
+		return Decode(TextureFilter::Sample(m_MipLevels, 0, uv, uvDdx, uvDdy, sampleState,
+			[this](const MipLevel& level, int x, int y) { return Unpack(FetchTexel(level, x, y)); },
+			[](float) {}));
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "ColorRGB.h"
+#include "Vector3.h"
+#include "Texture.h"
+
+namespace dae
+{
+	struct Vector2;
+	struct Material;
+
+	//Everything the pixel shader reads from a material's maps at one uv
+	struct MaterialSample
+	{
+		ColorRGB diffuse{};
+		float glossiness{};
+		//Tangent space, z is rebuilt from xy
+		Vector3 normal{ 0.f, 0.f, 1.f };
+		float specular{};
+	};
+
+	//A material's diffuse, gloss, normal and specular maps baked into one interleaved texel,
+	//diffuse rgb + gloss in the low 32 bits and normal xy + specular in the high 32 bits
+	class MaterialTexture final
+	{
+	public:
+		//Nullptr when the material has fewer than two maps worth interleaving
+		static MaterialTexture* Bake(const Material& material);
+
+		MaterialSample Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, SampleState sampleState) const;
+
+		bool HasNormalMap() const { return m_HasNormalMap; };
+		bool HasSpecular() const { return m_HasSpecular; };
+
+	private:
+		MaterialTexture(int width, int height);
+
+		static constexpr int NrChannels{ 8 };
+
+		//Channels as floats in [0, 1] while filtering, decoded once at the end
+		struct Channels
+		{
+			float values[NrChannels]{};
+
+			static Channels Lerp(const Channels& a, const Channels& b, float factor);
+			Channels& operator+=(const Channels& other);
+			Channels operator/(float divisor) const;
+		};
+
+		//Stored in 4x4 blocks like the tiled textures, a block spans two cache lines
+		struct MipLevel
+		{
+			uint64_t* pTexels{};
+			int width{};
+			int height{};
+			int blocksPerRow{};
+			bool isPowerOfTwo{ false };
+			int widthMask{};
+			int heightMask{};
+		};
+
+		static constexpr int BlockSize{ 4 };
+
+		//Cache line aligned, so each block covers exactly two lines
+		std::vector<uint64_t, AlignedAllocator<uint64_t, CacheLineSize>> m_TexelStorage{};
+		std::vector<MipLevel> m_MipLevels{};
+
+		bool m_HasNormalMap{ false };
+		bool m_HasSpecular{ false };
+
+		void BuildMipChain();
+
+		uint64_t& TexelAt(const MipLevel& level, int x, int y) const;
+		uint64_t FetchTexel(const MipLevel& level, int x, int y) const;
+
+		static Channels Unpack(uint64_t texel);
+		MaterialSample Decode(const Channels& channels) const;
+	};
+}
@@ -6,6 +6,7 @@
 
 #include "MathHelpers.h"
 #include <cmath>
+#include <immintrin.h>
 
 namespace dae {
 	Matrix::Matrix(const Vector3& xAxis, const Vector3& yAxis, const Vector3& zAxis, const Vector3& t) :
@@ -72,6 +73,207 @@ namespace dae {
 		};
 	}
 
+#pragma region Batch Transforms
+	namespace
+	{
+#if defined(__AVX__)
+		using SimdFloat = __m256;
+		constexpr size_t SimdWidth{ 8 };
+		inline SimdFloat SimdSet1(float v) { return _mm256_set1_ps(v); }
+		inline SimdFloat SimdLoad(const float* p) { return _mm256_loadu_ps(p); }
+		inline void SimdStore(float* p, SimdFloat v) { _mm256_storeu_ps(p, v); }
+		inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm256_add_ps(a, b); }
+		inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm256_sub_ps(a, b); }
+		inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm256_mul_ps(a, b); }
+		inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm256_div_ps(a, b); }
+		inline SimdFloat SimdGather(const float* p, size_t stride)
+		{
+			return _mm256_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride], p[4 * stride], p[5 * stride], p[6 * stride], p[7 * stride]);
+		}
+#else
+		using SimdFloat = __m128;
+		constexpr size_t SimdWidth{ 4 };
+		inline SimdFloat SimdSet1(float v) { return _mm_set1_ps(v); }
+		inline SimdFloat SimdLoad(const float* p) { return _mm_loadu_ps(p); }
+		inline void SimdStore(float* p, SimdFloat v) { _mm_storeu_ps(p, v); }
+		inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return _mm_add_ps(a, b); }
+		inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return _mm_sub_ps(a, b); }
+		inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return _mm_mul_ps(a, b); }
+		inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return _mm_div_ps(a, b); }
+		inline SimdFloat SimdGather(const float* p, size_t stride)
+		{
+			return _mm_setr_ps(p[0], p[stride], p[2 * stride], p[3 * stride]);
+		}
+#endif
+
+		//Row-vector convention, out = x * row0 + y * row1 + z * row2 (+ row3 for points)
+		struct SimdMatrix
+		{
+			SimdFloat m[4][4];
+
+			SimdMatrix(const Matrix& matrix)
+			{
+				for (int r{ 0 }; r < 4; ++r)
+				{
+					for (int c{ 0 }; c < 4; ++c)
+					{
+						m[r][c] = SimdSet1(matrix[r][c]);
+					}
+				}
+			}
+
+			SimdFloat Row(SimdFloat x, SimdFloat y, SimdFloat z, int c) const
+			{
+				return SimdAdd(SimdAdd(SimdMul(x, m[0][c]), SimdMul(y, m[1][c])), SimdMul(z, m[2][c]));
+			}
+		};
+	}
+
+	void Matrix::TransformPoints(const Vector3* pPoints, size_t count, size_t stride, float* pOutX, float* pOutY, float* pOutZ, float* pOutW) const
+	{
+		const SimdMatrix m{ *this };
+		const float* pSource{ reinterpret_cast<const float*>(pPoints) };
+		const size_t floatStride{ stride / sizeof(float) };
+
+		size_t i{};
+		for (; i + SimdWidth <= count; i += SimdWidth)
+		{
+			const float* pBase{ pSource + i * floatStride };
+			const SimdFloat x{ SimdGather(pBase, floatStride) };
+			const SimdFloat y{ SimdGather(pBase + 1, floatStride) };
+			const SimdFloat z{ SimdGather(pBase + 2, floatStride) };
+
+			SimdStore(pOutX + i, SimdAdd(m.Row(x, y, z, 0), m.m[3][0]));
+			SimdStore(pOutY + i, SimdAdd(m.Row(x, y, z, 1), m.m[3][1]));
+			SimdStore(pOutZ + i, SimdAdd(m.Row(x, y, z, 2), m.m[3][2]));
+			SimdStore(pOutW + i, SimdAdd(m.Row(x, y, z, 3), m.m[3][3]));
+		}
+
+		for (; i < count; ++i)
+		{
+			const float* pBase{ pSource + i * floatStride };
+			const Vector4 out{ TransformPoint(pBase[0], pBase[1], pBase[2], 1.f) };
+			pOutX[i] = out.x;
+			pOutY[i] = out.y;
+			pOutZ[i] = out.z;
+			pOutW[i] = out.w;
+		}
+	}
+
+	void Matrix::TransformPoints(const float* pX, const float* pY, const float* pZ, size_t count, float* pOutX, float* pOutY, float* pOutZ, float* pOutW) const
+	{
+		const SimdMatrix m{ *this };
+
+		size_t i{};
+		for (; i + SimdWidth <= count; i += SimdWidth)
+		{
+			const SimdFloat x{ SimdLoad(pX + i) };
+			const SimdFloat y{ SimdLoad(pY + i) };
+			const SimdFloat z{ SimdLoad(pZ + i) };
+
+			SimdStore(pOutX + i, SimdAdd(m.Row(x, y, z, 0), m.m[3][0]));
+			SimdStore(pOutY + i, SimdAdd(m.Row(x, y, z, 1), m.m[3][1]));
+			SimdStore(pOutZ + i, SimdAdd(m.Row(x, y, z, 2), m.m[3][2]));
+			SimdStore(pOutW + i, SimdAdd(m.Row(x, y, z, 3), m.m[3][3]));
+		}
+
+		for (; i < count; ++i)
+		{
+			const Vector4 out{ TransformPoint(pX[i], pY[i], pZ[i], 1.f) };
+			pOutX[i] = out.x;
+			pOutY[i] = out.y;
+			pOutZ[i] = out.z;
+			pOutW[i] = out.w;
+		}
+	}
+
+	void Matrix::TransformVectors(const Vector3* pVectors, size_t count, size_t stride, float* pOutX, float* pOutY, float* pOutZ) const
+	{
+		const SimdMatrix m{ *this };
+		const float* pSource{ reinterpret_cast<const float*>(pVectors) };
+		const size_t floatStride{ stride / sizeof(float) };
+
+		size_t i{};
+		for (; i + SimdWidth <= count; i += SimdWidth)
+		{
+			const float* pBase{ pSource + i * floatStride };
+			const SimdFloat x{ SimdGather(pBase, floatStride) };
+			const SimdFloat y{ SimdGather(pBase + 1, floatStride) };
+			const SimdFloat z{ SimdGather(pBase + 2, floatStride) };
+
+			SimdStore(pOutX + i, m.Row(x, y, z, 0));
+			SimdStore(pOutY + i, m.Row(x, y, z, 1));
+			SimdStore(pOutZ + i, m.Row(x, y, z, 2));
+		}
+
+		for (; i < count; ++i)
+		{
+			const float* pBase{ pSource + i * floatStride };
+			const Vector3 out{ TransformVector(pBase[0], pBase[1], pBase[2]) };
+			pOutX[i] = out.x;
+			pOutY[i] = out.y;
+			pOutZ[i] = out.z;
+		}
+	}
+
+	void Matrix::TransformVectors(const float* pX, const float* pY, const float* pZ, size_t count, float* pOutX, float* pOutY, float* pOutZ) const
+	{
+		const SimdMatrix m{ *this };
+
+		size_t i{};
+		for (; i + SimdWidth <= count; i += SimdWidth)
+		{
+			const SimdFloat x{ SimdLoad(pX + i) };
+			const SimdFloat y{ SimdLoad(pY + i) };
+			const SimdFloat z{ SimdLoad(pZ + i) };
+
+			SimdStore(pOutX + i, m.Row(x, y, z, 0));
+			SimdStore(pOutY + i, m.Row(x, y, z, 1));
+			SimdStore(pOutZ + i, m.Row(x, y, z, 2));
+		}
+
+		for (; i < count; ++i)
+		{
+			const Vector3 out{ TransformVector(pX[i], pY[i], pZ[i]) };
+			pOutX[i] = out.x;
+			pOutY[i] = out.y;
+			pOutZ[i] = out.z;
+		}
+	}
+
+	void Matrix::PerspectiveDivideViewport(float* pX, float* pY, float* pZ, const float* pW, size_t count, float width, float height, float* pScreenX, float* pScreenY)
+	{
+		const SimdFloat one{ SimdSet1(1.f) };
+		const SimdFloat halfWidth{ SimdSet1(0.5f * width) };
+		const SimdFloat halfHeight{ SimdSet1(0.5f * height) };
+
+		size_t i{};
+		for (; i + SimdWidth <= count; i += SimdWidth)
+		{
+			const SimdFloat w{ SimdLoad(pW + i) };
+			const SimdFloat x{ SimdDiv(SimdLoad(pX + i), w) };
+			const SimdFloat y{ SimdDiv(SimdLoad(pY + i), w) };
+
+			SimdStore(pX + i, x);
+			SimdStore(pY + i, y);
+			SimdStore(pZ + i, SimdDiv(SimdLoad(pZ + i), w));
+
+			SimdStore(pScreenX + i, SimdMul(SimdAdd(x, one), halfWidth));
+			SimdStore(pScreenY + i, SimdMul(SimdSub(one, y), halfHeight));
+		}
+
+		for (; i < count; ++i)
+		{
+			pX[i] /= pW[i];
+			pY[i] /= pW[i];
+			pZ[i] /= pW[i];
+
+			pScreenX[i] = (pX[i] + 1.f) * 0.5f * width;
+			pScreenY[i] = (1.f - pY[i]) * 0.5f * height;
+		}
+	}
+#pragma endregion
+
 	const Matrix& Matrix::Transpose()
 	{
 		Matrix result{};
@@ -118,11 +320,12 @@ namespace dae {
 		const Vector3 r0 = Vector3::Cross(b, v) + t * y;
 		const Vector3 r1 = Vector3::Cross(v, a) - t * x;
 		const Vector3 r2 = Vector3::Cross(d, u) + s * w;
-		//Vector3 r3 = Vector3::Cross(u, c) - s * z;
+		//Keep the last column too, projection matrices are not affine
+		const Vector3 r3 = Vector3::Cross(u, c) - s * z;
 
-		data[0] = Vector4{ r0.x, r1.x, r2.x, 0.f };
-		data[1] = Vector4{ r0.y, r1.y, r2.y, 0.f };
-		data[2] = Vector4{ r0.z, r1.z, r2.z, 0.f };
+		data[0] = Vector4{ r0.x, r1.x, r2.x, r3.x };
+		data[1] = Vector4{ r0.y, r1.y, r2.y, r3.y };
+		data[2] = Vector4{ r0.z, r1.z, r2.z, r3.z };
 		data[3] = {-Vector3::Dot(b, t),Vector3::Dot(a, t),-Vector3::Dot(d, s),Vector3::Dot(c, s) };
 
 		return *this;
@@ -258,14 +461,20 @@ namespace dae {
 	Matrix Matrix::operator*(const Matrix& m) const
 	{
 		Matrix result{};
-		Matrix m_transposed = Transpose(m);
+
+		//Each result row is a linear combination of the rows of m, no transposed copy needed
+		const __m128 row0{ _mm_loadu_ps(&m.data[0].x) };
+		const __m128 row1{ _mm_loadu_ps(&m.data[1].x) };
+		const __m128 row2{ _mm_loadu_ps(&m.data[2].x) };
+		const __m128 row3{ _mm_loadu_ps(&m.data[3].x) };
 
 		for (int r{ 0 }; r < 4; ++r)
 		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				result[r][c] = Vector4::Dot(data[r], m_transposed[c]);
-			}
+			const __m128 combined{ _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(data[r].x), row0), _mm_mul_ps(_mm_set1_ps(data[r].y), row1)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(data[r].z), row2), _mm_mul_ps(_mm_set1_ps(data[r].w), row3))) };
+
+			_mm_storeu_ps(&result.data[r].x, combined);
 		}
 
 		return result;
@@ -273,17 +482,7 @@ namespace dae {
 
 	const Matrix& Matrix::operator*=(const Matrix& m)
 	{
-		Matrix copy{ *this };
-		Matrix m_transposed = Transpose(m);
-
-		for (int r{ 0 }; r < 4; ++r)
-		{
-			for (int c{ 0 }; c < 4; ++c)
-			{
-				data[r][c] = Vector4::Dot(copy[r], m_transposed[c]);
-			}
-		}
-
+		*this = *this * m;
 		return *this;
 	}
 #pragma endregion
@@ -28,6 +28,16 @@ namespace dae {
 		Vector4 TransformPoint(const Vector4& p) const;
 		Vector4 TransformPoint(float x, float y, float z, float w) const;
 
+		//Batch transforms, 4 (SSE) or 8 (AVX) elements per instruction with SoA output.
+		//AoS input takes a byte stride so positions can be read straight out of a vertex array.
+		void TransformPoints(const Vector3* pPoints, size_t count, size_t stride, float* pOutX, float* pOutY, float* pOutZ, float* pOutW) const;
+		void TransformPoints(const float* pX, const float* pY, const float* pZ, size_t count, float* pOutX, float* pOutY, float* pOutZ, float* pOutW) const;
+		void TransformVectors(const Vector3* pVectors, size_t count, size_t stride, float* pOutX, float* pOutY, float* pOutZ) const;
+		void TransformVectors(const float* pX, const float* pY, const float* pZ, size_t count, float* pOutX, float* pOutY, float* pOutZ) const;
+
+		//Divides x, y and z by w in place and maps x and y from ndc to screen space
+		static void PerspectiveDivideViewport(float* pX, float* pY, float* pZ, const float* pW, size_t count, float width, float height, float* pScreenX, float* pScreenY);
+
 		const Matrix& Transpose();
 		const Matrix& Inverse();
 
@@ -4,7 +4,10 @@
 #include "EffectShader.h"
 #include "EffectTransparency.h"
 #include "Texture.h"
+#include "MaterialTexture.h"
 #include "Utils.h"
+#include "TaskGraph.h"
+#include <bit>
 
 #define USE_OBJ
 
@@ -19,12 +22,6 @@ namespace dae {
 
 		InitHardware();
 
-		m_pDiffuseMap = Texture::LoadFromFile("Resources/vehicle_diffuse.png", m_pDevice);
-		m_pFireDiffuseMap = Texture::LoadFromFile("Resources/fireFX_diffuse.png", m_pDevice);
-		m_pGlossinessMap = Texture::LoadFromFile("Resources/vehicle_gloss.png", m_pDevice);
-		m_pNormalMap = Texture::LoadFromFile("Resources/vehicle_normal.png", m_pDevice);
-		m_pSpecularMap = Texture::LoadFromFile("Resources/vehicle_specular.png", m_pDevice);
-
 		InitMeshes();
 
 		InitSoftware();
@@ -38,11 +35,12 @@ namespace dae {
 			delete mesh;
 		}
 
-		delete m_pDiffuseMap;
-		delete m_pFireDiffuseMap;
-		delete m_pSpecularMap;
-		delete m_pNormalMap;
-		delete m_pGlossinessMap;
+		for (auto& material : m_pMaterials)
+		{
+			delete material->pPackedMaps;
+			delete material;
+		}
+
 
 		if (m_pRenderTargetView)
 		{
@@ -77,16 +75,23 @@ namespace dae {
 
 
 		delete[] m_pDepthBufferPixels;
+		delete[] m_pRenderBufferPixels;
 
 	}
 
-	void Renderer::Update(const Timer* pTimer)
+	void Renderer::Update(float deltaTime)
 	{
-		m_Camera.Update(pTimer);
+		m_Camera.StorePreviousState();
+		for (auto& mesh : m_pMeshes)
+		{
+			mesh->StorePreviousState();
+		}
+
+		m_Camera.Update(deltaTime);
 
 		if (m_IsRotating)
 		{
-			const float meshRotation{ 45.0f * pTimer->GetElapsed() * TO_RADIANS };
+			const float meshRotation{ 45.0f * deltaTime * TO_RADIANS };
 			for (auto& mesh : m_pMeshes)
 			{
 				mesh->RotateMesh(meshRotation);
@@ -94,8 +99,14 @@ namespace dae {
 		}
 	}
 
-	void Renderer::Render()
+	void Renderer::Render(float interpolationAlpha)
 	{
+		m_Camera.Interpolate(interpolationAlpha);
+		for (auto& mesh : m_pMeshes)
+		{
+			mesh->Interpolate(interpolationAlpha);
+		}
+
 		switch (m_CurrentRenderMode)
 		{
 		case dae::Renderer::RenderMode::Hardware:
@@ -103,6 +114,7 @@ namespace dae {
 			break;
 		case dae::Renderer::RenderMode::Software:
 			RenderSoftware();
+			m_TextureStreamer.Update();
 			break;
 		}
 
@@ -110,9 +122,7 @@ namespace dae {
 
 	void Renderer::ToggleSampleState()
 	{
-		if (m_CurrentRenderMode == RenderMode::Software)
-			return;
-
+		//Shared by both paths, the software sampler reads m_SampleState directly
 		m_SampleState = static_cast<SampleState>((static_cast<int>(m_SampleState) + 1) % (static_cast<int>(SampleState::Anisotropic) + 1));
 
 		D3D11_FILTER filter{};
@@ -122,9 +132,13 @@ namespace dae {
 			filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
 			std::cout << "Current Sample State: Point\n";
 			break;
-		case SampleState::Linear:
+		case SampleState::Bilinear:
+			filter = D3D11_FILTER_MIN_MAG_LINEAR_MIP_POINT;
+			std::cout << "Current Sample State: Bilinear\n";
+			break;
+		case SampleState::Trilinear:
 			filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-			std::cout << "Current Sample State: Linear\n";
+			std::cout << "Current Sample State: Trilinear\n";
 			break;
 		case SampleState::Anisotropic:
 			filter = D3D11_FILTER_ANISOTROPIC;
@@ -294,9 +308,6 @@ namespace dae {
 
 	void Renderer::ToggleFire()
 	{
-		if (m_CurrentRenderMode == RenderMode::Software)
-			return;
-
 		m_RenderFire = !m_RenderFire;
 		switch (m_RenderFire)
 		{
@@ -327,6 +338,114 @@ namespace dae {
 
 	}
 
+	void Renderer::ToggleDynamicResolution()
+	{
+		if (m_CurrentRenderMode == RenderMode::Hardware)
+			return;
+		m_UseDynamicResolution = !m_UseDynamicResolution;
+		if (!m_UseDynamicResolution)
+		{
+			m_ResolutionScale = 1.f;
+		}
+		switch (m_UseDynamicResolution)
+		{
+		case true:
+			std::cout << "Dynamic Resolution: ON\n";
+			break;
+		case false:
+			std::cout << "Dynamic Resolution: OFF\n";
+			break;
+		}
+	}
+
+	void Renderer::ToggleVariableRateShading()
+	{
+		if (m_CurrentRenderMode == RenderMode::Hardware)
+			return;
+		m_UseVariableRateShading = !m_UseVariableRateShading;
+		switch (m_UseVariableRateShading)
+		{
+		case true:
+			std::cout << "Variable Rate Shading: ON\n";
+			break;
+		case false:
+			std::cout << "Variable Rate Shading: OFF\n";
+			break;
+		}
+	}
+
+	void Renderer::ToggleCheckerboard()
+	{
+		if (m_CurrentRenderMode == RenderMode::Hardware)
+			return;
+		m_UseCheckerboard = !m_UseCheckerboard;
+		m_IsHistoryValid = false;
+		switch (m_UseCheckerboard)
+		{
+		case true:
+			std::cout << "Checkerboard Rendering: ON\n";
+			break;
+		case false:
+			std::cout << "Checkerboard Rendering: OFF\n";
+			break;
+		}
+	}
+
+	void Renderer::ToggleInstancing()
+	{
+		m_UseInstancing = !m_UseInstancing;
+
+		//A grid of copies around the original, the same matrices for the vehicle and its fire
+		std::vector<Matrix> instanceMatrices{};
+		if (m_UseInstancing)
+		{
+			const int halfGrid{ m_InstanceGridSize / 2 };
+			for (int z{ -halfGrid }; z <= halfGrid; ++z)
+			{
+				for (int x{ -halfGrid }; x <= halfGrid; ++x)
+				{
+					instanceMatrices.push_back(Matrix::CreateTranslation(x * m_InstanceSpacing, 0.f, z * m_InstanceSpacing));
+				}
+			}
+		}
+
+		for (Mesh* pMesh : m_pMeshes)
+		{
+			pMesh->SetInstances(m_pDevice, instanceMatrices);
+		}
+
+		switch (m_UseInstancing)
+		{
+		case true:
+			std::cout << "Instancing: ON (" << instanceMatrices.size() << " instances)\n";
+			break;
+		case false:
+			std::cout << "Instancing: OFF\n";
+			break;
+		}
+	}
+
+	void Renderer::ToggleTopDownView()
+	{
+		if (m_CurrentRenderMode == RenderMode::Hardware)
+			return;
+		m_ShowTopDownView = !m_ShowTopDownView;
+		switch (m_ShowTopDownView)
+		{
+		case true:
+			std::cout << "Top Down View: ON\n";
+			break;
+		case false:
+			std::cout << "Top Down View: OFF\n";
+			break;
+		}
+	}
+
+	void Renderer::SetFrameTimeBudget(float milliseconds)
+	{
+		m_FrameTimeBudget = std::max(milliseconds, 1.f);
+	}
+
 	void Renderer::InitHardware()
 	{
 		const HRESULT result = InitializeDirectX();
@@ -468,12 +587,20 @@ namespace dae {
 		return S_OK;
 	}
 
-	Matrix Renderer::MakeWorldMatrix()
+	Transform Renderer::MakeStartTransform()
 	{
 		const Vector3 position{ m_Camera.origin + Vector3{ 0, 0, 50 } };
 		const Vector3 rotation{ };
 		const Vector3 scale{ Vector3{ 1, 1, 1 } };
-		return Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation) * Matrix::CreateTranslation(position);
+		return Transform{ position, rotation, scale };
+	}
+
+	Material* Renderer::CreateMaterial(const Material& material)
+	{
+		Material* pMaterial{ new Material{ material } };
+		pMaterial->id = static_cast<uint16_t>(m_pMaterials.size());
+		m_pMaterials.emplace_back(pMaterial);
+		return pMaterial;
 	}
 
 	void Renderer::InitMeshes()
@@ -481,38 +608,126 @@ namespace dae {
 #ifdef USE_OBJ
 
 
-		const Matrix worldMatrix = MakeWorldMatrix();
+		const Transform startTransform = MakeStartTransform();
+
+		//Every load, parse and upload is its own task, the device is free threaded so GPU resources are created on the workers too
+		TaskGraph startupGraph{};
+
+#pragma region Textures
+		const auto addTextureTask = [&](std::shared_ptr<Texture>& pTexture, const std::string& path)
+		{
+			return startupGraph.AddTask(path, [this, &pTexture, path]()
+				{
+					pTexture = m_TextureCache.Load(path, m_pDevice, m_SoftwareTexelLayout);
+				});
+		};
+
+		const TaskGraph::TaskId diffuseMapTask{ addTextureTask(m_pDiffuseMap, "Resources/vehicle_diffuse.png") };
+		const TaskGraph::TaskId fireDiffuseMapTask{ addTextureTask(m_pFireDiffuseMap, "Resources/fireFX_diffuse.png") };
+		const TaskGraph::TaskId glossinessMapTask{ addTextureTask(m_pGlossinessMap, "Resources/vehicle_gloss.png") };
+		const TaskGraph::TaskId normalMapTask{ addTextureTask(m_pNormalMap, "Resources/vehicle_normal.png") };
+		const TaskGraph::TaskId specularMapTask{ addTextureTask(m_pSpecularMap, "Resources/vehicle_specular.png") };
+#pragma endregion
 
 #pragma region Vehicle
 		std::vector<uint32_t> indecesVehicle;
 		std::vector<Vertex_In> verticesVehicle;
-		Utils::ParseOBJ("Resources/vehicle.obj", verticesVehicle, indecesVehicle);
-		EffectShader* pShader = new EffectShader(m_pDevice, L"Resources/Shader.fx");
+		EffectShader* pShader{};
+		Mesh* pMeshVehicle{};
+		Material vehicleMaterial{};
 
-		pShader->SetDiffuseMap(m_pDiffuseMap);
-		pShader->SetNormalMap(m_pNormalMap);
-		pShader->SetGlossinessMap(m_pGlossinessMap);
-		pShader->SetSpecularMap(m_pSpecularMap);
+		const TaskGraph::TaskId parseVehicleTask{ startupGraph.AddTask("Parse vehicle.obj", [&]()
+			{
+				Utils::ParseOBJ("Resources/vehicle.obj", verticesVehicle, indecesVehicle);
+			}) };
 
-		Mesh* pMeshVehicle = new Mesh(m_pDevice, verticesVehicle, indecesVehicle, pShader);
+		const TaskGraph::TaskId vehicleTangentsTask{ startupGraph.AddTask("Vehicle tangents", [&]()
+			{
+				Utils::ComputeTangents(verticesVehicle, indecesVehicle);
+			}, { parseVehicleTask }) };
 
+		const TaskGraph::TaskId vehicleEffectTask{ startupGraph.AddTask("Compile Shader.fx", [&]()
+			{
+				pShader = new EffectShader(m_pDevice, L"Resources/Shader.fx");
+			}) };
 
-		pMeshVehicle->SetWorldMatrix(worldMatrix);
+		startupGraph.AddTask("Vehicle buffers", [&]()
+			{
+				pMeshVehicle = new Mesh(m_pDevice, verticesVehicle, indecesVehicle, pShader);
+			}, { vehicleTangentsTask, vehicleEffectTask });
 
-		m_pMeshes.emplace_back(pMeshVehicle);
+		startupGraph.AddTask("Bake vehicle material", [&]()
+			{
+				vehicleMaterial = { m_pDiffuseMap, m_pNormalMap, m_pSpecularMap, m_pGlossinessMap };
+
+				//Packed maps are a full resident copy the streamer cannot shrink, maps baked to containers are sampled separately instead
+				const bool canStream{ m_pDiffuseMap->CanStream() || m_pNormalMap->CanStream() || m_pSpecularMap->CanStream() || m_pGlossinessMap->CanStream() };
+				if (!canStream)
+				{
+					vehicleMaterial.pPackedMaps = MaterialTexture::Bake(vehicleMaterial);
+				}
+			}, { diffuseMapTask, normalMapTask, specularMapTask, glossinessMapTask });
 #pragma endregion
 
 #pragma region Fire
 		std::vector<uint32_t> indecesFire;
 		std::vector<Vertex_In> verticesFire;
-		Utils::ParseOBJ("Resources/fireFX.obj", verticesFire, indecesFire);
+		EffectTransparency* pTransparent{};
+		Mesh* pMeshFire{};
+
+		const TaskGraph::TaskId parseFireTask{ startupGraph.AddTask("Parse fireFX.obj", [&]()
+			{
+				Utils::ParseOBJ("Resources/fireFX.obj", verticesFire, indecesFire);
+			}) };
+
+		const TaskGraph::TaskId fireTangentsTask{ startupGraph.AddTask("Fire tangents", [&]()
+			{
+				Utils::ComputeTangents(verticesFire, indecesFire);
+			}, { parseFireTask }) };
+
+		const TaskGraph::TaskId fireEffectTask{ startupGraph.AddTask("Compile Transparency.fx", [&]()
+			{
+				pTransparent = new EffectTransparency(m_pDevice, L"Resources/Transparency.fx");
+			}) };
+
+		startupGraph.AddTask("Fire buffers", [&]()
+			{
+				pMeshFire = new Mesh(m_pDevice, verticesFire, indecesFire, pTransparent);
+			}, { fireTangentsTask, fireEffectTask });
+#pragma endregion
+
+		startupGraph.Run(m_ThreadPool);
+		startupGraph.PrintTimings();
+
+		//After the bake, which needs the full resolution maps. Only maps loaded from containers register, and those were not packed
+		for (const std::shared_ptr<Texture>& pTexture : { m_pFireDiffuseMap, m_pDiffuseMap, m_pGlossinessMap, m_pNormalMap, m_pSpecularMap })
+		{
+			m_TextureStreamer.Register(pTexture);
+		}
+
+		//Registered on this thread in a fixed order, the meshes are indexed and the materials numbered by it
+#pragma region Vehicle
+		pShader->SetDiffuseMap(m_pDiffuseMap.get());
+		pShader->SetNormalMap(m_pNormalMap.get());
+		pShader->SetGlossinessMap(m_pGlossinessMap.get());
+		pShader->SetSpecularMap(m_pSpecularMap.get());
+
+		pMeshVehicle->SetMaterial(CreateMaterial(vehicleMaterial));
+
+		pMeshVehicle->GetTransform() = startTransform;
 
-		EffectTransparency* pTransparent = new EffectTransparency(m_pDevice, L"Resources/Transparency.fx");
-		pTransparent->SetDiffuseMap(m_pFireDiffuseMap);
+		m_pMeshes.emplace_back(pMeshVehicle);
+#pragma endregion
+
+#pragma region Fire
+		pTransparent->SetDiffuseMap(m_pFireDiffuseMap.get());
 
-		Mesh* pMeshFire = new Mesh(m_pDevice, verticesFire, indecesFire, pTransparent);
+		Material fireMaterial{};
+		fireMaterial.pDiffuseMap = m_pFireDiffuseMap;
+		fireMaterial.isTransparent = true;
+		pMeshFire->SetMaterial(CreateMaterial(fireMaterial));
 
-		pMeshFire->SetWorldMatrix(worldMatrix);
+		pMeshFire->GetTransform() = startTransform;
 
 		m_pMeshes.emplace_back(pMeshFire);
 #pragma endregion
@@ -586,12 +801,15 @@ namespace dae {
 		m_pDeviceContext->ClearRenderTargetView(m_pRenderTargetView, &clearColor.r);
 		m_pDeviceContext->ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.f, 0);
 
-		const Matrix worldViewProjectionMatrix{ m_pMeshes[0]->GetWorldMatrix() * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+		const Frustum& frustum{ m_Camera.GetFrustum() };
 
-		m_pMeshes[0]->Render(m_pDeviceContext, worldViewProjectionMatrix, m_Camera.invViewMatrix);
-		if (m_RenderFire)
+		if (!m_pMeshes[0]->IsOutsideFrustum(frustum))
 		{
-			m_pMeshes[1]->Render(m_pDeviceContext, worldViewProjectionMatrix, m_Camera.invViewMatrix);
+			m_pMeshes[0]->Render(m_pDeviceContext, m_Camera.viewProjectionMatrix, m_Camera.viewVersion, m_Camera.invViewMatrix);
+		}
+		if (m_RenderFire && !m_pMeshes[1]->IsOutsideFrustum(frustum))
+		{
+			m_pMeshes[1]->Render(m_pDeviceContext, m_Camera.viewProjectionMatrix, m_Camera.viewVersion, m_Camera.invViewMatrix);
 		}
 
 
@@ -608,46 +826,244 @@ namespace dae {
 
 		m_pDepthBufferPixels = new float[m_Width * m_Height];
 
+		//Allocated at window size so the internal resolution can change without reallocating
+		m_pRenderBufferPixels = new uint32_t[m_Width * m_Height];
+		m_RenderWidth = m_Width;
+		m_RenderHeight = m_Height;
+
+		m_UpscaleColumns.resize(m_Width);
+
+		m_CoarseShadeColors.resize(m_Width * m_Height);
+		m_CoarseShadeStamps.resize(m_Width * m_Height);
+
+		m_HistoryPixels.resize(m_Width * m_Height);
+	}
+
+	void Renderer::BeginWorldStage(Mesh& mesh)
+	{
+		//Pre-sized so every chunk writes its own range without synchronisation
+		const size_t nrVertices{ mesh.GetVerticesIn().size() };
+		mesh.GetVerticesOutReference().resize(nrVertices);
+		m_WorldPositions.resize(nrVertices);
+		m_WorldAttributeStamps.resize(nrVertices);
+
+		//World space attributes of the previous item are stale, they are filled in lazily by the views
+		if (++m_WorldAttributeStamp == 0)
+		{
+			std::fill(m_WorldAttributeStamps.begin(), m_WorldAttributeStamps.end(), 0);
+			m_WorldAttributeStamp = 1;
+		}
 	}
 
-	void Renderer::VertexTransformationFunction()
+	void Renderer::VertexTransformationFunction(Mesh& mesh, const Matrix& meshWorldMatrix, const Matrix& worldViewProjectionMatrix)
 	{
-		std::vector<Vertex_Out>& verticesOut = m_pMeshes[0]->GetVerticesOutReference();
-		verticesOut.clear();
-		verticesOut.reserve(m_pMeshes[0]->GetVerticesIn().size());
+		const std::vector<Vertex_In>& verticesIn = mesh.GetVerticesIn();
+		std::vector<Vertex_Out>& verticesOut = mesh.GetVerticesOutReference();
+
+		const size_t nrVertices{ verticesIn.size() };
+		m_ScreenVertices.resize(nrVertices);
+		m_PositionsX.resize(nrVertices);
+		m_PositionsY.resize(nrVertices);
+		m_PositionsZ.resize(nrVertices);
+		m_PositionsW.resize(nrVertices);
+		m_ScreenX.resize(nrVertices);
+		m_ScreenY.resize(nrVertices);
+		m_VertexAttributeStamps.resize(nrVertices);
+
+		if (++m_VertexAttributeStamp == 0)
+		{
+			std::fill(m_VertexAttributeStamps.begin(), m_VertexAttributeStamps.end(), 0);
+			m_VertexAttributeStamp = 1;
+		}
+
+		const float renderWidth{ static_cast<float>(m_pCurrentView->width) };
+		const float renderHeight{ static_cast<float>(m_pCurrentView->height) };
+		const Vector3 viewOrigin{ m_pCurrentView->invViewMatrix.GetTranslation() };
+
+		//Positions for every vertex, culling needs them
+		m_ThreadPool.ParallelFor(nrVertices, m_VertexChunkSize, [&](size_t begin, size_t end)
+			{
+				const size_t count{ end - begin };
+
+				worldViewProjectionMatrix.TransformPoints(&verticesIn[begin].position, count, sizeof(Vertex_In),
+					&m_PositionsX[begin], &m_PositionsY[begin], &m_PositionsZ[begin], &m_PositionsW[begin]);
+
+				Matrix::PerspectiveDivideViewport(&m_PositionsX[begin], &m_PositionsY[begin], &m_PositionsZ[begin], &m_PositionsW[begin],
+					count, renderWidth, renderHeight, &m_ScreenX[begin], &m_ScreenY[begin]);
+			});
+
+		SetupTriangles(mesh, meshWorldMatrix);
+
+		//Remaining attributes only for the vertices a surviving triangle references
+		m_ThreadPool.ParallelFor(nrVertices, m_VertexChunkSize, [&](size_t begin, size_t end)
+			{
+				for (size_t i{ begin }; i < end; ++i)
+				{
+					if (m_VertexAttributeStamps[i] != m_VertexAttributeStamp)
+						continue;
+
+					Vertex_Out& vertexOut{ verticesOut[i] };
+
+					//View independent, computed by the first view that needs the vertex and shared with the others
+					if (m_WorldAttributeStamps[i] != m_WorldAttributeStamp)
+					{
+						const Vertex_In& vertex{ verticesIn[i] };
+
+						vertexOut.color = vertex.color;
+						vertexOut.uv = vertex.uv;
+						vertexOut.normal = meshWorldMatrix.TransformVector(vertex.normal);
+						vertexOut.tangent = meshWorldMatrix.TransformVector(vertex.tangent);
+						m_WorldPositions[i] = meshWorldMatrix.TransformPoint(vertex.position);
+
+						m_WorldAttributeStamps[i] = m_WorldAttributeStamp;
+					}
 
-		const Matrix meshWorldMatrix = m_pMeshes[0]->GetWorldMatrix();
+					vertexOut.position = { m_PositionsX[i], m_PositionsY[i], m_PositionsZ[i], m_PositionsW[i] };
+					vertexOut.viewDirection = (m_WorldPositions[i] - viewOrigin).Normalized();
 
-		const Matrix worldViewProjectionMatrix{ meshWorldMatrix * m_Camera.viewMatrix * m_Camera.projectionMatrix };
+					m_ScreenVertices[i] = { m_ScreenX[i], m_ScreenY[i] };
+				}
+			});
+	}
+
+	void Renderer::SetupTriangles(const Mesh& mesh, const Matrix& worldMatrix)
+	{
+		const std::vector<uint32_t>& indeces = mesh.GetIndeces();
 
-		for (const Vertex_In& vertex : m_pMeshes[0]->GetVerticesIn())
+		m_VisibleTriangles.clear();
+
+		const auto addTriangle = [&](int index0, int index1, int index2)
 		{
-			Vertex_Out vertexOut{ {}, vertex.color, vertex.uv, vertex.normal, vertex.normal };
-			vertexOut.position = worldViewProjectionMatrix.TransformPoint({ vertex.position, 1.0f });
+			const uint32_t vertex0{ indeces[index0] };
+			const uint32_t vertex1{ indeces[index1] };
+			const uint32_t vertex2{ indeces[index2] };
 
+			if (!IsTriangleVisible(vertex0, vertex1, vertex2))
+				return;
 
-			vertexOut.viewDirection = Vector3{ vertexOut.position.x, vertexOut.position.y, vertexOut.position.z }.Normalized();
+			m_VisibleTriangles.push_back(index0);
+			m_VisibleTriangles.push_back(index1);
+			m_VisibleTriangles.push_back(index2);
 
-			vertexOut.normal = meshWorldMatrix.TransformVector(vertex.normal);
-			vertexOut.tangent = meshWorldMatrix.TransformVector(vertex.tangent);
+			m_VertexAttributeStamps[vertex0] = m_VertexAttributeStamp;
+			m_VertexAttributeStamps[vertex1] = m_VertexAttributeStamp;
+			m_VertexAttributeStamps[vertex2] = m_VertexAttributeStamp;
+		};
 
+		switch (mesh.GetPrimitiveTopoligy())
+		{
+		case PrimitiveTopology::TriangleList:
+		{
+			const Vector3 cameraPosition{ m_pCurrentView->invViewMatrix.GetTranslation() };
 
-			vertexOut.position.x /= vertexOut.position.w;
-			vertexOut.position.y /= vertexOut.position.w;
-			vertexOut.position.z /= vertexOut.position.w;
+			//Whole clusters are rejected before looking at their triangles
+			for (const Meshlet& meshlet : mesh.GetMeshlets())
+			{
+				if (IsMeshletCulled(meshlet, worldMatrix, cameraPosition))
+					continue;
 
-			verticesOut.emplace_back(vertexOut);
+				const int endIndex{ static_cast<int>(meshlet.firstIndex + meshlet.nrTriangles * 3) };
+				for (int i{ static_cast<int>(meshlet.firstIndex) }; i < endIndex; i += 3)
+				{
+					addTriangle(i, i + 1, i + 2);
+				}
+			}
+		}
+		break;
+		case PrimitiveTopology::TriangleStrip:
+
+			for (int i{}; i < static_cast<int>(indeces.size()) - 2; ++i)
+			{
+				// if n&1 is 1, then odd, else even
+				const bool swapIndeces = i % 2;
+
+				const int index1 = i + !swapIndeces * 1 + swapIndeces * 2;
+				const int index2 = i + !swapIndeces * 2 + swapIndeces * 1;
+
+				addTriangle(i, index1, index2);
+			}
+			break;
+		}
+	}
+
+	bool Renderer::IsMeshletCulled(const Meshlet& meshlet, const Matrix& worldMatrix, const Vector3& cameraPosition) const
+	{
+		const BoundingSphere bounds{ meshlet.bounds.Transformed(worldMatrix) };
+		if (m_pCurrentView->frustum.IsOutside(bounds))
+			return true;
+
+		if (m_DrawBoundingBox || meshlet.coneCutoff >= 1.f)
+			return false;
+
+		//Assumes the world matrix has no non uniform scale, the cone axis is transformed like a direction
+		Vector3 coneAxis{ worldMatrix.TransformVector(meshlet.coneAxis).Normalized() };
+		switch (m_CurrentMeshCullMode)
+		{
+		case dae::Renderer::CullMode::Back:
+			break;
+		case dae::Renderer::CullMode::Front:
+			coneAxis = -coneAxis;
+			break;
+		case dae::Renderer::CullMode::None:
+		default:
+			return false;
+		}
+
+		//Every triangle faces away from the camera when the view direction falls inside the cone
+		const Vector3 toCenter{ bounds.center - cameraPosition };
+		return Vector3::Dot(toCenter, coneAxis) >= meshlet.coneCutoff * toCenter.Magnitude() + bounds.radius;
+	}
+
+	bool Renderer::IsTriangleVisible(uint32_t vertex0, uint32_t vertex1, uint32_t vertex2) const
+	{
+		const auto isOutside = [this](uint32_t vertex)
+		{
+			return PositionOutsideFrustrum({ m_PositionsX[vertex], m_PositionsY[vertex], m_PositionsZ[vertex], m_PositionsW[vertex] });
+		};
+
+		if (isOutside(vertex0) || isOutside(vertex1) || isOutside(vertex2))
+			return false;
+
+		//The bounding box debug view shows every triangle in the frustum
+		if (m_DrawBoundingBox)
+			return true;
+
+		//Pixels inside the triangle share the sign of its area, the per pixel cull test can only pass for the matching winding
+		const Vector2 screen0{ m_ScreenX[vertex0], m_ScreenY[vertex0] };
+		const Vector2 screen1{ m_ScreenX[vertex1], m_ScreenY[vertex1] };
+		const Vector2 screen2{ m_ScreenX[vertex2], m_ScreenY[vertex2] };
+
+		const float triangleArea{ Vector2::Cross(screen1 - screen0, screen2 - screen1) };
+
+		switch (m_CurrentMeshCullMode)
+		{
+		case dae::Renderer::CullMode::Back:
+			return triangleArea > 0.f;
+		case dae::Renderer::CullMode::Front:
+			return triangleArea < 0.f;
+		case dae::Renderer::CullMode::None:
+		default:
+			return triangleArea != 0.f;
 		}
 	}
 
 	void Renderer::RenderTraingle(int i0, int i1, int i2, std::vector<Vector2>& screenVertices,
 		std::vector<Vertex_Out>& verticesOut, const std::vector<uint32_t>& indeces)
 	{
+		//A new stamp per triangle invalidates the coarse colors shaded for the previous one
+		if (++m_TriangleStamp == 0)
+		{
+			std::fill(m_CoarseShadeStamps.begin(), m_CoarseShadeStamps.end(), 0);
+			m_TriangleStamp = 1;
+		}
 
-		if (PositionOutsideFrustrum(verticesOut[indeces[i0]].position) ||
-			PositionOutsideFrustrum(verticesOut[indeces[i1]].position) ||
-			PositionOutsideFrustrum(verticesOut[indeces[i2]].position))
-			return;
+		//Target and size of the view being rasterized, only the main view uses checkerboard and variable rate shading
+		const SoftwareView& view{ *m_pCurrentView };
+		uint32_t* const pColorPixels{ view.pColorPixels };
+		float* const pDepthPixels{ view.pDepthPixels };
+		const int width{ view.width };
+		const int height{ view.height };
+		const bool useCheckerboard{ m_UseCheckerboard && view.isMainView };
 
 		const Vector2& vertex0{ screenVertices[indeces[i0]] };
 		const Vector2& vertex1{ screenVertices[indeces[i1]] };
@@ -659,27 +1075,54 @@ namespace dae {
 
 		const float triangleArea{ Vector2::Cross(edge0, edge1) };
 
+		//The weights are linear in screen space, their change per pixel step is constant over the triangle
+		const Vector2 weightV0Step{ -edge1.y / triangleArea, edge1.x / triangleArea };
+		const Vector2 weightV1Step{ -edge2.y / triangleArea, edge2.x / triangleArea };
+		const Vector2 weightV2Step{ -edge0.y / triangleArea, edge0.x / triangleArea };
+
+		//Perspective correct attributes divide by w, done once per vertex instead of once per pixel
+		const Vertex_Out& v0{ verticesOut[indeces[i0]] };
+		const Vertex_Out& v1{ verticesOut[indeces[i1]] };
+		const Vertex_Out& v2{ verticesOut[indeces[i2]] };
+
+		const float invW0{ 1.0f / v0.position.w };
+		const float invW1{ 1.0f / v1.position.w };
+		const float invW2{ 1.0f / v2.position.w };
+
+		const Vector2 uvOverW0{ v0.uv * invW0 };
+		const Vector2 uvOverW1{ v1.uv * invW1 };
+		const Vector2 uvOverW2{ v2.uv * invW2 };
+
+		//Without any map the uv derivatives are never read
+		const Material& material{ *m_pCurrentMaterial };
+		const bool samplesTexture{ material.pPackedMaps || material.pDiffuseMap || material.pNormalMap || material.pSpecularMap || material.pGlossinessMap };
+
 
 		const Vector2 minBB{ Vector2::Min(vertex0, Vector2::Min(vertex1, vertex2)) };
 		const Vector2 maxBB{ Vector2::Max(vertex0, Vector2::Max(vertex1, vertex2)) };
 
 
-		const int startX{ std::clamp(static_cast<int>(minBB.x) - 1, 0, m_Width) };
-		const int startY{ std::clamp(static_cast<int>(minBB.y) - 1, 0, m_Height) };
-		const int endX{ std::clamp(static_cast<int>(maxBB.x) + 1, 0, m_Width) };
-		const int endY{ std::clamp(static_cast<int>(maxBB.y) + 1, 0, m_Height) };
+		const int startX{ std::clamp(static_cast<int>(minBB.x) - 1, 0, width) };
+		const int startY{ std::clamp(static_cast<int>(minBB.y) - 1, 0, height) };
+		const int endX{ std::clamp(static_cast<int>(maxBB.x) + 1, 0, width) };
+		const int endY{ std::clamp(static_cast<int>(maxBB.y) + 1, 0, height) };
+
 
+		//In checkerboard mode only the pixels whose parity matches the frame are rasterized
+		const int stepY{ useCheckerboard ? 2 : 1 };
 
 		for (int px{ startX }; px < endX; ++px)
 		{
-			for (int py{ startY }; py < endY; ++py)
+			const int firstY{ (useCheckerboard && ((px + startY + m_FrameIndex) & 1)) ? startY + 1 : startY };
+
+			for (int py{ firstY }; py < endY; py += stepY)
 			{
-				const int pixelIndex{ px + py * m_Width };
+				const int pixelIndex{ px + py * width };
 				const Vector2 currentPixel{ static_cast<float>(px), static_cast<float>(py) };
 
 				if (m_DrawBoundingBox)
 				{
-					m_pBackBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+					pColorPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
 						static_cast<uint8_t>(255),
 						static_cast<uint8_t>(255),
 						static_cast<uint8_t>(255));
@@ -736,10 +1179,10 @@ namespace dae {
 				};
 
 
-				if (m_pDepthBufferPixels[pixelIndex] < interpolatedZDepth)
+				if (pDepthPixels[pixelIndex] < interpolatedZDepth)
 					continue;
 
-				m_pDepthBufferPixels[pixelIndex] = interpolatedZDepth;
+				pDepthPixels[pixelIndex] = interpolatedZDepth;
 
 
 				switch (m_CurrentBufferMode)
@@ -747,75 +1190,115 @@ namespace dae {
 				case dae::Renderer::BufferMode::Texture:
 				{
 
-					const Vertex_Out& v0 = verticesOut[indeces[i0]];
-					const Vertex_Out& v1 = verticesOut[indeces[i1]];
-					const Vertex_Out& v2 = verticesOut[indeces[i2]];
-
-					Vertex_Out interpolatedVertex{};
-
-					const float interpolatedWWeight
+					//Shade once per coarse block and broadcast the color to the other pixels of the block the triangle covers
+					const ShadingRate shadingRate{ view.isMainView ? GetPixelShadingRate(px, py) : ShadingRate::Rate1x1 };
+					int coarseIndex{ -1 };
+					Vector2 coarseSize{ 1.f, 1.f };
+					switch (shadingRate)
 					{
-						1.0f / (
-							weightV0 / v0.position.w +
-							weightV1 / v1.position.w +
-							weightV2 / v2.position.w
-							)
-					};
-
-					// uv
-
-
-					const Vector2 uvInterpolated0{ weightV0 * (v0.uv / v0.position.w) };
-					const Vector2 uvInterpolated1{ weightV1 * (v1.uv / v1.position.w) };
-					const Vector2 uvInterpolated2{ weightV2 * (v2.uv / v2.position.w) };
-
-					interpolatedVertex.uv = { (uvInterpolated0 + uvInterpolated1 + uvInterpolated2) * interpolatedWWeight };
-
-
-					//color
-					interpolatedVertex.color = v0.color * weightV0 + v1.color * weightV1 + v2.color * weightV2;
-
-					//normal
-					const Vector3 normalInterpolated0{ weightV0 * (v0.normal / v0.position.w) };
-					const Vector3 normalInterpolated1{ weightV1 * (v1.normal / v1.position.w) };
-					const Vector3 normalInterpolated2{ weightV2 * (v2.normal / v2.position.w) };
-
-					interpolatedVertex.normal = {
-						(
-						(normalInterpolated0 + normalInterpolated1 + normalInterpolated2)
-						* interpolatedWWeight
-						).Normalized() };
-
-					//tangent
-					const Vector3 tangentInterpolated0{ weightV0 * (v0.tangent / v0.position.w) };
-					const Vector3 tangentInterpolated1{ weightV1 * (v1.tangent / v1.position.w) };
-					const Vector3 tangentInterpolated2{ weightV2 * (v2.tangent / v2.position.w) };
-
-					interpolatedVertex.tangent = {
-						(
-						(tangentInterpolated0 + tangentInterpolated1 + tangentInterpolated2)
-						* interpolatedWWeight
-						).Normalized() };;
-
-
-
-					//viewDir
-					const Vector3 viewDirInterpolated0{ weightV0 * (v0.viewDirection / v0.position.w) };
-					const Vector3 viewDirInterpolated1{ weightV1 * (v1.viewDirection / v1.position.w) };
-					const Vector3 viewDirInterpolated2{ weightV2 * (v2.viewDirection / v2.position.w) };
-
-					interpolatedVertex.viewDirection = {
-						(
-						(viewDirInterpolated0 + viewDirInterpolated1 + viewDirInterpolated2)
-						* interpolatedWWeight
-						).Normalized() };;
-
-
-					ColorRGB finalColor = PixelShading(interpolatedVertex);
-
-					finalColor.MaxToOne();
-
-					m_pBackBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+					case ShadingRate::Rate2x1:
+						coarseIndex = (px & ~1) + py * width;
+						coarseSize = { 2.f, 1.f };
+						break;
+					case ShadingRate::Rate2x2:
+						coarseIndex = (px & ~1) + (py & ~1) * width;
+						coarseSize = { 2.f, 2.f };
+						break;
+					case ShadingRate::Rate4x4:
+						coarseIndex = (px & ~3) + (py & ~3) * width;
+						coarseSize = { 4.f, 4.f };
+						break;
+					default:
+						break;
+					}
+
+					ColorRGB finalColor{};
+					if (coarseIndex >= 0 && m_CoarseShadeStamps[coarseIndex] == m_TriangleStamp)
+					{
+						finalColor = m_CoarseShadeColors[coarseIndex];
+					}
+					else
+					{
+						Vertex_Out interpolatedVertex{};
+
+						const float interpolatedWWeight
+						{
+							1.0f / (
+								weightV0 * invW0 +
+								weightV1 * invW1 +
+								weightV2 * invW2
+								)
+						};
+
+						// uv
+						const auto interpolateUV = [&](float w0, float w1, float w2)
+						{
+							return (w0 * uvOverW0 + w1 * uvOverW1 + w2 * uvOverW2) / (w0 * invW0 + w1 * invW1 + w2 * invW2);
+						};
+
+						interpolatedVertex.uv = { (weightV0 * uvOverW0 + weightV1 * uvOverW1 + weightV2 * uvOverW2) * interpolatedWWeight };
+
+						//uv one pixel to the right and one down, a coarse shade covers its whole block
+						Vector2 uvDdx{};
+						Vector2 uvDdy{};
+						if (samplesTexture)
+						{
+							uvDdx = (interpolateUV(weightV0 + weightV0Step.x, weightV1 + weightV1Step.x, weightV2 + weightV2Step.x) - interpolatedVertex.uv) * coarseSize.x;
+							uvDdy = (interpolateUV(weightV0 + weightV0Step.y, weightV1 + weightV1Step.y, weightV2 + weightV2Step.y) - interpolatedVertex.uv) * coarseSize.y;
+						}
+
+
+						//color
+						interpolatedVertex.color = v0.color * weightV0 + v1.color * weightV1 + v2.color * weightV2;
+
+						//normal
+						const Vector3 normalInterpolated0{ weightV0 * (v0.normal * invW0) };
+						const Vector3 normalInterpolated1{ weightV1 * (v1.normal * invW1) };
+						const Vector3 normalInterpolated2{ weightV2 * (v2.normal * invW2) };
+
+						interpolatedVertex.normal = {
+							(
+							(normalInterpolated0 + normalInterpolated1 + normalInterpolated2)
+							* interpolatedWWeight
+							).Normalized() };
+
+						//tangent
+						const Vector3 tangentInterpolated0{ weightV0 * (v0.tangent * invW0) };
+						const Vector3 tangentInterpolated1{ weightV1 * (v1.tangent * invW1) };
+						const Vector3 tangentInterpolated2{ weightV2 * (v2.tangent * invW2) };
+
+						interpolatedVertex.tangent = {
+							(
+							(tangentInterpolated0 + tangentInterpolated1 + tangentInterpolated2)
+							* interpolatedWWeight
+							).Normalized() };;
+
+
+
+						//viewDir
+						const Vector3 viewDirInterpolated0{ weightV0 * (v0.viewDirection * invW0) };
+						const Vector3 viewDirInterpolated1{ weightV1 * (v1.viewDirection * invW1) };
+						const Vector3 viewDirInterpolated2{ weightV2 * (v2.viewDirection * invW2) };
+
+						interpolatedVertex.viewDirection = {
+							(
+							(viewDirInterpolated0 + viewDirInterpolated1 + viewDirInterpolated2)
+							* interpolatedWWeight
+							).Normalized() };;
+
+
+						finalColor = PixelShading(interpolatedVertex, uvDdx, uvDdy, material);
+
+						finalColor.MaxToOne();
+
+						if (coarseIndex >= 0)
+						{
+							m_CoarseShadeColors[coarseIndex] = finalColor;
+							m_CoarseShadeStamps[coarseIndex] = m_TriangleStamp;
+						}
+					}
+
+					pColorPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
 						static_cast<uint8_t>(finalColor.r * 255),
 						static_cast<uint8_t>(finalColor.g * 255),
 						static_cast<uint8_t>(finalColor.b * 255));
@@ -829,7 +1312,7 @@ namespace dae {
 
 					const ColorRGB finalColor{ depthVal, depthVal, depthVal };
 
-					m_pBackBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+					pColorPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
 						static_cast<uint8_t>(finalColor.r * 255),
 						static_cast<uint8_t>(finalColor.g * 255),
 						static_cast<uint8_t>(finalColor.b * 255));
@@ -849,23 +1332,57 @@ namespace dae {
 		return v.x < -1.0f || v.x > 1.0f || v.y < -1.0f || v.y > 1.0f || v.z < 0.0f || v.z > 1.0f;
 	}
 
-	ColorRGB Renderer::PixelShading(const Vertex_Out& v)
+	ColorRGB Renderer::PixelShading(const Vertex_Out& v, const Vector2& uvDdx, const Vector2& uvDdy, const Material& material)
 	{
+		//A baked material needs one fetch for every map, otherwise each map is sampled on its own
+		MaterialSample maps{};
+		ColorRGB specularColor{};
+		bool hasNormalMap{};
+		bool hasSpecular{};
+		if (material.pPackedMaps)
+		{
+			maps = material.pPackedMaps->Sample(v.uv, uvDdx, uvDdy, m_SampleState);
+			hasNormalMap = material.pPackedMaps->HasNormalMap();
+			hasSpecular = material.pPackedMaps->HasSpecular();
+
+			//The packed texel only has room for one specular channel
+			specularColor = { maps.specular, maps.specular, maps.specular };
+		}
+		else
+		{
+			const auto sample = [&](const std::shared_ptr<Texture>& pTexture)
+			{
+				return pTexture->Sample(v.uv, uvDdx, uvDdy, m_SampleState);
+			};
+
+			//Maps a material does not have fall back to the vertex color and no specular
+			maps.diffuse = material.pDiffuseMap ? sample(material.pDiffuseMap) : v.color;
+			hasNormalMap = material.pNormalMap != nullptr;
+			hasSpecular = material.pSpecularMap && material.pGlossinessMap;
+
+			if (m_UseNormalMap && hasNormalMap)
+			{
+				const ColorRGB normalMap{ 2.0f * sample(material.pNormalMap) - ColorRGB{ 1.0f, 1.0f, 1.0f } };
+				maps.normal = { normalMap.r, normalMap.g, normalMap.b };
+			}
+
+			if (hasSpecular)
+			{
+				maps.glossiness = sample(material.pGlossinessMap).r;
+				specularColor = sample(material.pSpecularMap);
+			}
+		}
 
 		Vector3 pixelNormal{ v.normal };
 
 
-		if (m_UseNormalMap)
+		if (m_UseNormalMap && hasNormalMap)
 		{
 			const Vector3 binormal = Vector3::Cross(v.normal, v.tangent);
 
 			const Matrix tangentSpaceAxis = Matrix{ v.tangent, binormal, v.normal, Vector3::Zero };
 
-			const ColorRGB currentNormalMap{ 2.0f * m_pNormalMap->Sample(v.uv) - ColorRGB{ 1.0f, 1.0f, 1.0f } };
-
-			const Vector3 normalMapSample{ currentNormalMap.r, currentNormalMap.g, currentNormalMap.b };
-
-			pixelNormal = tangentSpaceAxis.TransformVector(normalMapSample).Normalized();
+			pixelNormal = tangentSpaceAxis.TransformVector(maps.normal).Normalized();
 		}
 
 		const Vector3 lightDirection = Vector3{ .577f, -.577f, .577f }.Normalized();
@@ -874,7 +1391,6 @@ namespace dae {
 		const float lightIntensity{ 7.0f };
 		const float glossiness{ 25.0f };
 
-
 		switch (m_CurrentColorMode)
 		{
 		case dae::Renderer::ColorMode::ObservedArea:
@@ -883,25 +1399,32 @@ namespace dae {
 		case dae::Renderer::ColorMode::Diffuse:
 		{
 
-			const ColorRGB lambert{ BRDF_Utils::Lambert(1.0f, m_pDiffuseMap->Sample(v.uv)) };
+			const ColorRGB lambert{ BRDF_Utils::Lambert(1.0f, maps.diffuse) };
 
 			return (lightIntensity * lambert) * observedArea;
 		}
 		break;
 		case dae::Renderer::ColorMode::Specular:
 		{
-			const float phongExponent{ m_pGlossinessMap->Sample(v.uv).r * glossiness };
+			if (!hasSpecular)
+				return colors::Black;
+
+			const float phongExponent{ maps.glossiness * glossiness };
 
-			return m_pSpecularMap->Sample(v.uv) * BRDF_Utils::Phong(1.0f, phongExponent, -lightDirection, v.viewDirection, pixelNormal);
+			return specularColor * BRDF_Utils::Phong(1.0f, phongExponent, -lightDirection, v.viewDirection, pixelNormal);
 		}
 		break;
 		case dae::Renderer::ColorMode::Combined:
 		{
-			const ColorRGB lambert{ BRDF_Utils::Lambert(1.0f, m_pDiffuseMap->Sample(v.uv)) };
+			const ColorRGB lambert{ BRDF_Utils::Lambert(1.0f, maps.diffuse) };
 
-			const float phongExponent{ m_pGlossinessMap->Sample(v.uv).r * glossiness };
+			ColorRGB specular{ colors::Black };
+			if (hasSpecular)
+			{
+				const float phongExponent{ maps.glossiness * glossiness };
 
-			const ColorRGB specular{ m_pSpecularMap->Sample(v.uv) * BRDF_Utils::Phong(1.0f, phongExponent, -lightDirection, v.viewDirection, pixelNormal) };
+				specular = specularColor * BRDF_Utils::Phong(1.0f, phongExponent, -lightDirection, v.viewDirection, pixelNormal);
+			}
 
 			return (lightIntensity * lambert + specular) * observedArea;
 		}
@@ -915,77 +1438,619 @@ namespace dae {
 	//Lock BackBuffer
 		SDL_LockSurface(m_pBackBuffer);
 
+		const uint64_t rasterStart{ SDL_GetPerformanceCounter() };
+
+		m_RenderWidth = std::max(static_cast<int>(m_Width * m_ResolutionScale), 1);
+		m_RenderHeight = std::max(static_cast<int>(m_Height * m_ResolutionScale), 1);
+
 		//clear background
+		const int nrPixels{ m_RenderWidth * m_RenderHeight };
 		if (m_UseUniformColor)
 		{
 			const int color{ static_cast<int>(0.1f * 255) };
-			SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, color, color, color));
+			std::fill_n(m_pRenderBufferPixels, nrPixels, SDL_MapRGB(m_pBackBuffer->format, color, color, color));
 		}
 		else
 		{
 			const int color{ static_cast <int>(0.39f * 255) };
-			SDL_FillRect(m_pBackBuffer, NULL, SDL_MapRGB(m_pBackBuffer->format, color, color, color));
+			std::fill_n(m_pRenderBufferPixels, nrPixels, SDL_MapRGB(m_pBackBuffer->format, color, color, color));
 		}
 
 		//reset buffer
-		const int nrPixels{ m_Width * m_Height };
 		std::fill_n(m_pDepthBufferPixels, nrPixels, FLT_MAX);
 
-		//Rasterization
-		VertexTransformationFunction();
-
-		std::vector<Vector2> screenVertices{};
-		std::vector<Vertex_Out>& verticesOut = m_pMeshes[0]->GetVerticesOutReference();
-		const std::vector<uint32_t> indeces = m_pMeshes[0]->GetIndeces();
-
-		screenVertices.reserve(verticesOut.size());
-		for (auto& vertex : verticesOut)
+		//The camera's view goes first, transparents and the reconstruction below only run on it
+		m_Views.clear();
+		m_Views.push_back({ m_Camera.invViewMatrix, m_Camera.viewProjectionMatrix, m_Camera.GetFrustum(),
+			m_pRenderBufferPixels, m_pDepthBufferPixels, m_RenderWidth, m_RenderHeight, true });
+		if (m_ShowTopDownView)
 		{
-			screenVertices.push_back({
-				(vertex.position.x + 1) * 0.5f * m_Width,
-				(1.0f - vertex.position.y) * 0.5f * m_Height
-				});
+			m_Views.push_back(MakeTopDownView());
 		}
 
-		//RENDER LOGIC
-		switch (m_pMeshes[0]->GetPrimitiveTopoligy())
+		//Rasterization, mesh instances outside every view frustum never make it into the draw list
+		BuildDrawList();
+
+		//Opaques only, the list is sorted so every transparent item comes after them
+		size_t firstTransparentItem{};
+		for (; firstTransparentItem < m_DrawList.size(); ++firstTransparentItem)
 		{
-		case PrimitiveTopology::TriangleList:
+			const DrawItem& item{ m_DrawList[firstTransparentItem] };
+			if (item.pMaterial->isTransparent)
+				break;
 
-			for (int i{}; i < indeces.size(); i += 3)
-			{
-				const int index0{ i }, index1{ i + 1 }, index2{ i + 2 };
+			Mesh& mesh{ *item.pMesh };
 
-				RenderTraingle(index0, index1, index2, screenVertices, verticesOut, indeces);
+			m_pCurrentMaterial = item.pMaterial;
+			m_CurrentMeshShadingRate = mesh.GetShadingRate();
+			m_CurrentMeshCullMode = m_CurrentCullMode;
 
-			}
-			break;
-		case PrimitiveTopology::TriangleStrip:
+			BeginWorldStage(mesh);
 
-			for (int i{}; i < m_pMeshes[0]->GetIndeces().size() - 2; ++i)
+			std::vector<Vector2>& screenVertices = m_ScreenVertices;
+			std::vector<Vertex_Out>& verticesOut = mesh.GetVerticesOutReference();
+			const std::vector<uint32_t>& indeces = mesh.GetIndeces();
+
+			//World space work is shared, only the projection, setup and raster run per view
+			for (const SoftwareView& view : m_Views)
 			{
+				if (mesh.IsOutsideFrustum(view.frustum, item.worldMatrix))
+					continue;
 
-				const int index0{ i };
-				int index1{}, index2{};
-				// if n&1 is 1, then odd, else even
+				m_pCurrentView = &view;
+				VertexTransformationFunction(mesh, item.worldMatrix,
+					view.isMainView ? item.worldViewProjectionMatrix : item.worldMatrix * view.viewProjectionMatrix);
 
-				const bool swapIndeces = i % 2;
+				//RENDER LOGIC
+				for (size_t i{}; i < m_VisibleTriangles.size(); i += 3)
+				{
+					RenderTraingle(m_VisibleTriangles[i], m_VisibleTriangles[i + 1], m_VisibleTriangles[i + 2], screenVertices, verticesOut, indeces);
+				}
+			}
+		}
 
+		if (m_UseCheckerboard)
+		{
+			ReconstructCheckerboard();
+			StoreHistory();
+			++m_FrameIndex;
+		}
 
-				index1 = i + !swapIndeces * 1 + swapIndeces * 2;
-				index2 = i + !swapIndeces * 2 + swapIndeces * 1;
+		//After the reconstruction so the history only ever holds opaque pixels
+		if (m_CurrentBufferMode == BufferMode::Texture && !m_DrawBoundingBox)
+		{
+			RenderTransparents(firstTransparentItem);
+		}
 
-				RenderTraingle(index0, index1, index2, screenVertices, verticesOut, indeces);
-			}
-			break;
+		UpdateShadingRateImage();
+
+		if (m_ShowTopDownView)
+		{
+			CompositeTopDownView(m_Views[1]);
 		}
 
+		const float rasterTime{ static_cast<float>(SDL_GetPerformanceCounter() - rasterStart) * 1000.f / static_cast<float>(SDL_GetPerformanceFrequency()) };
 
+		UpscaleToBackBuffer();
 
 		//@END
 		//Update SDL Surface
 		SDL_UnlockSurface(m_pBackBuffer);
 		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
 		SDL_UpdateWindowSurface(m_pWindow);
+
+		UpdateResolutionScale(rasterTime);
+	}
+
+	void Renderer::RenderTransparents(size_t firstItem)
+	{
+		m_TransparentTriangles.clear();
+
+		//Fire is made of two sided cards
+		m_CurrentMeshCullMode = CullMode::None;
+		m_pCurrentView = &m_Views.front();
+
+		for (size_t itemIndex{ firstItem }; itemIndex < m_DrawList.size(); ++itemIndex)
+		{
+			const DrawItem& item{ m_DrawList[itemIndex] };
+			Mesh& mesh{ *item.pMesh };
+			if (mesh.IsOutsideFrustum(m_pCurrentView->frustum, item.worldMatrix))
+				continue;
+
+			BeginWorldStage(mesh);
+			VertexTransformationFunction(mesh, item.worldMatrix, item.worldViewProjectionMatrix);
+
+			//The vertex stage reuses its buffers for every item, keep copies until the tiles are blended
+			const std::vector<Vertex_Out>& verticesOut{ mesh.GetVerticesOutReference() };
+			const std::vector<uint32_t>& indeces{ mesh.GetIndeces() };
+			for (size_t i{}; i < m_VisibleTriangles.size(); i += 3)
+			{
+				TransparentTriangle triangle{};
+				triangle.pMaterial = item.pMaterial;
+				for (int v{}; v < 3; ++v)
+				{
+					const uint32_t vertex{ indeces[m_VisibleTriangles[i + v]] };
+					triangle.vertices[v] = verticesOut[vertex];
+					triangle.screenPositions[v] = m_ScreenVertices[vertex];
+					triangle.viewDepth += verticesOut[vertex].position.w;
+				}
+				m_TransparentTriangles.push_back(triangle);
+			}
+		}
+
+		if (m_TransparentTriangles.empty())
+			return;
+
+		//Bin every triangle into the tiles its bounding box touches
+		const int nrTilesX{ (m_RenderWidth + m_TransparentTileSize - 1) / m_TransparentTileSize };
+		const int nrTilesY{ (m_RenderHeight + m_TransparentTileSize - 1) / m_TransparentTileSize };
+		m_TransparentTileBins.resize(static_cast<size_t>(nrTilesX) * nrTilesY);
+		for (auto& bin : m_TransparentTileBins)
+		{
+			bin.clear();
+		}
+
+		for (uint32_t triangleIndex{}; triangleIndex < m_TransparentTriangles.size(); ++triangleIndex)
+		{
+			const Vector2* screenPositions{ m_TransparentTriangles[triangleIndex].screenPositions };
+			const Vector2 minBB{ Vector2::Min(screenPositions[0], Vector2::Min(screenPositions[1], screenPositions[2])) };
+			const Vector2 maxBB{ Vector2::Max(screenPositions[0], Vector2::Max(screenPositions[1], screenPositions[2])) };
+
+			const int startTileX{ std::clamp(static_cast<int>(minBB.x) / m_TransparentTileSize, 0, nrTilesX - 1) };
+			const int startTileY{ std::clamp(static_cast<int>(minBB.y) / m_TransparentTileSize, 0, nrTilesY - 1) };
+			const int endTileX{ std::clamp(static_cast<int>(maxBB.x) / m_TransparentTileSize, 0, nrTilesX - 1) };
+			const int endTileY{ std::clamp(static_cast<int>(maxBB.y) / m_TransparentTileSize, 0, nrTilesY - 1) };
+
+			for (int tileY{ startTileY }; tileY <= endTileY; ++tileY)
+			{
+				for (int tileX{ startTileX }; tileX <= endTileX; ++tileX)
+				{
+					m_TransparentTileBins[tileX + tileY * nrTilesX].push_back(triangleIndex);
+				}
+			}
+		}
+
+		//Tiles own disjoint pixels, so they sort and blend independently
+		m_ThreadPool.ParallelFor(m_TransparentTileBins.size(), 1, [&](size_t begin, size_t end)
+			{
+				for (size_t tile{ begin }; tile < end; ++tile)
+				{
+					std::vector<uint32_t>& bin{ m_TransparentTileBins[tile] };
+					if (bin.empty())
+						continue;
+
+					//Back to front, the draw order breaks ties
+					std::stable_sort(bin.begin(), bin.end(), [this](uint32_t a, uint32_t b)
+						{
+							return m_TransparentTriangles[a].viewDepth > m_TransparentTriangles[b].viewDepth;
+						});
+
+					const int tileX{ static_cast<int>(tile) % nrTilesX };
+					const int tileY{ static_cast<int>(tile) / nrTilesX };
+					const int minX{ tileX * m_TransparentTileSize };
+					const int minY{ tileY * m_TransparentTileSize };
+					const int maxX{ std::min(minX + m_TransparentTileSize, m_RenderWidth) };
+					const int maxY{ std::min(minY + m_TransparentTileSize, m_RenderHeight) };
+
+					for (uint32_t triangleIndex : bin)
+					{
+						BlendTransparentTriangle(m_TransparentTriangles[triangleIndex], minX, minY, maxX, maxY);
+					}
+				}
+			});
+	}
+
+	void Renderer::BlendTransparentTriangle(const TransparentTriangle& triangle, int minX, int minY, int maxX, int maxY)
+	{
+		const Vector2& vertex0{ triangle.screenPositions[0] };
+		const Vector2& vertex1{ triangle.screenPositions[1] };
+		const Vector2& vertex2{ triangle.screenPositions[2] };
+
+		const Vector2 edge0{ vertex1 - vertex0 };
+		const Vector2 edge1{ vertex2 - vertex1 };
+		const Vector2 edge2{ vertex0 - vertex2 };
+
+		const float triangleArea{ Vector2::Cross(edge0, edge1) };
+
+		const Vector2 minBB{ Vector2::Min(vertex0, Vector2::Min(vertex1, vertex2)) };
+		const Vector2 maxBB{ Vector2::Max(vertex0, Vector2::Max(vertex1, vertex2)) };
+
+		const int startX{ std::clamp(static_cast<int>(minBB.x) - 1, minX, maxX) };
+		const int startY{ std::clamp(static_cast<int>(minBB.y) - 1, minY, maxY) };
+		const int endX{ std::clamp(static_cast<int>(maxBB.x) + 1, minX, maxX) };
+		const int endY{ std::clamp(static_cast<int>(maxBB.y) + 1, minY, maxY) };
+
+		const Vertex_Out& v0{ triangle.vertices[0] };
+		const Vertex_Out& v1{ triangle.vertices[1] };
+		const Vertex_Out& v2{ triangle.vertices[2] };
+
+		const Texture* pDiffuseMap{ triangle.pMaterial->pDiffuseMap.get() };
+
+		for (int py{ startY }; py < endY; ++py)
+		{
+			for (int px{ startX }; px < endX; ++px)
+			{
+				const Vector2 currentPixel{ static_cast<float>(px), static_cast<float>(py) };
+
+				const float edge0PixelCross{ Vector2::Cross(edge0, currentPixel - vertex0) };
+				const float edge1PixelCross{ Vector2::Cross(edge1, currentPixel - vertex1) };
+				const float edge2PixelCross{ Vector2::Cross(edge2, currentPixel - vertex2) };
+
+				//Either winding
+				const bool doesHitFront{ edge0PixelCross > 0 && edge1PixelCross > 0 && edge2PixelCross > 0 };
+				const bool doesHitBack{ edge0PixelCross < 0 && edge1PixelCross < 0 && edge2PixelCross < 0 };
+				if (!doesHitFront && !doesHitBack)
+					continue;
+
+				const float weightV0{ edge1PixelCross / triangleArea };
+				const float weightV1{ edge2PixelCross / triangleArea };
+				const float weightV2{ edge0PixelCross / triangleArea };
+
+				const float interpolatedZDepth
+				{
+					1.0f / (weightV0 / v0.position.z + weightV1 / v1.position.z + weightV2 / v2.position.z)
+				};
+
+				//Tested against the opaques but never written, transparents do not hide each other
+				const int pixelIndex{ px + py * m_RenderWidth };
+				if (m_pDepthBufferPixels[pixelIndex] < interpolatedZDepth)
+					continue;
+
+				const float interpolatedWWeight
+				{
+					1.0f / (weightV0 / v0.position.w + weightV1 / v1.position.w + weightV2 / v2.position.w)
+				};
+
+				const Vector2 uv{
+					(weightV0 * (v0.uv / v0.position.w) + weightV1 * (v1.uv / v1.position.w) + weightV2 * (v2.uv / v2.position.w))
+					* interpolatedWWeight };
+
+				ColorRGB sourceColor{ v0.color * weightV0 + v1.color * weightV1 + v2.color * weightV2 };
+				float alpha{ 1.f };
+				if (pDiffuseMap)
+				{
+					sourceColor = pDiffuseMap->Sample(uv);
+					alpha = pDiffuseMap->SampleAlpha(uv);
+				}
+
+				if (alpha <= 0.f)
+					continue;
+
+				uint8_t r, g, b;
+				SDL_GetRGB(m_pRenderBufferPixels[pixelIndex], m_pBackBuffer->format, &r, &g, &b);
+				const ColorRGB destinationColor{ r / 255.f, g / 255.f, b / 255.f };
+
+				ColorRGB finalColor{ sourceColor * alpha + destinationColor * (1.f - alpha) };
+				finalColor.MaxToOne();
+
+				m_pRenderBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+					static_cast<uint8_t>(finalColor.r * 255),
+					static_cast<uint8_t>(finalColor.g * 255),
+					static_cast<uint8_t>(finalColor.b * 255));
+			}
+		}
+	}
+
+	Renderer::SoftwareView Renderer::MakeTopDownView()
+	{
+		const int width{ std::max(m_RenderWidth / m_TopDownViewDivisor, 1) };
+		const int height{ std::max(m_RenderHeight / m_TopDownViewDivisor, 1) };
+		m_TopDownColorPixels.resize(static_cast<size_t>(width) * height);
+		m_TopDownDepthPixels.resize(static_cast<size_t>(width) * height);
+
+		std::fill(m_TopDownColorPixels.begin(), m_TopDownColorPixels.end(), SDL_MapRGB(m_pBackBuffer->format, 0, 0, 0));
+		std::fill(m_TopDownDepthPixels.begin(), m_TopDownDepthPixels.end(), FLT_MAX);
+
+		//Looking straight down at the ground in front of the camera, top of the image is the camera's forward
+		Vector3 flatForward{ m_Camera.invViewMatrix.GetAxisZ() };
+		flatForward.y = 0.f;
+		flatForward = flatForward.SqrMagnitude() > 0.f ? flatForward.Normalized() : Vector3::UnitZ;
+
+		const Vector3 forward{ -Vector3::UnitY };
+		const Vector3 right{ Vector3::Cross(flatForward, forward).Normalized() };
+		const Vector3 up{ Vector3::Cross(forward, right) };
+		const Vector3 origin{ m_Camera.invViewMatrix.GetTranslation() + flatForward * m_TopDownViewDistance + Vector3::UnitY * m_TopDownViewHeight };
+
+		const Matrix invViewMatrix{ right, up, forward, origin };
+		const Matrix projectionMatrix{ Matrix::CreatePerspectiveFovLH(1.f, static_cast<float>(width) / height, m_Camera.nearPlane, m_Camera.farPlane) };
+		const Matrix viewProjectionMatrix{ Matrix::Inverse(invViewMatrix) * projectionMatrix };
+
+		return { invViewMatrix, viewProjectionMatrix, Frustum::FromViewProjection(viewProjectionMatrix),
+			m_TopDownColorPixels.data(), m_TopDownDepthPixels.data(), width, height, false };
+	}
+
+	void Renderer::CompositeTopDownView(const SoftwareView& view)
+	{
+		//Picture in picture in the top right corner
+		const int offsetX{ m_RenderWidth - view.width };
+		for (int py{}; py < view.height; ++py)
+		{
+			std::copy_n(view.pColorPixels + py * view.width, view.width, m_pRenderBufferPixels + offsetX + py * m_RenderWidth);
+		}
+	}
+
+	void Renderer::BuildDrawList()
+	{
+		m_DrawList.clear();
+
+		const Vector3 cameraPosition{ m_Camera.invViewMatrix.GetTranslation() };
+		const Vector3 cameraForward{ m_Camera.invViewMatrix.GetAxisZ() };
+
+		for (Mesh* pMesh : m_pMeshes)
+		{
+			const Material* pMaterial{ pMesh->GetMaterial() };
+			if (!pMaterial || (pMaterial->isTransparent && !m_RenderFire))
+				continue;
+
+			const bool isInstanced{ !pMesh->GetInstances().empty() };
+			for (uint32_t instance{}; instance < pMesh->GetNrInstances(); ++instance)
+			{
+				const Matrix worldMatrix{ pMesh->GetInstanceWorldMatrix(instance) };
+				const bool isOutsideAllViews{ std::all_of(m_Views.begin(), m_Views.end(), [&](const SoftwareView& view)
+					{
+						return pMesh->IsOutsideFrustum(view.frustum, worldMatrix);
+					}) };
+				if (isOutsideAllViews)
+					continue;
+
+				DrawItem item{ pMesh, pMaterial, worldMatrix };
+				item.worldViewProjectionMatrix = isInstanced ?
+					worldMatrix * m_Camera.viewProjectionMatrix :
+					pMesh->GetWorldViewProjectionMatrix(m_Camera.viewProjectionMatrix, m_Camera.viewVersion);
+
+				const Vector3 center{ pMesh->GetBoundingSphere().Transformed(worldMatrix).center };
+				item.sortKey = MakeSortKey(*pMaterial, Vector3::Dot(center - cameraPosition, cameraForward));
+
+				m_DrawList.push_back(item);
+			}
+		}
+
+		std::sort(m_DrawList.begin(), m_DrawList.end(), [](const DrawItem& a, const DrawItem& b) { return a.sortKey < b.sortKey; });
+	}
+
+	uint64_t Renderer::MakeSortKey(const Material& material, float viewDepth)
+	{
+		//Positive floats keep their order when read as integers
+		uint32_t depthBits{ std::bit_cast<uint32_t>(std::max(viewDepth, 0.f)) };
+
+		//Transparents after all opaques and back to front, opaques front to back so the depth test rejects more pixels before shading
+		if (material.isTransparent)
+			depthBits = ~depthBits;
+
+		//Layer | depth | material, equal depths keep the same material together
+		return static_cast<uint64_t>(material.isTransparent) << 63 | static_cast<uint64_t>(depthBits) << 16 | material.id;
+	}
+
+	void Renderer::ReconstructCheckerboard()
+	{
+		const Matrix& viewProjectionMatrix{ m_Camera.viewProjectionMatrix };
+
+		//Current ndc => world => previous clip space in one matrix
+		const Matrix reprojectionMatrix{ Matrix::Inverse(viewProjectionMatrix) * m_PreviousViewProjectionMatrix };
+
+		const bool useHistory{ m_IsHistoryValid && m_HistoryWidth == m_RenderWidth && m_HistoryHeight == m_RenderHeight };
+
+		const int neighbourOffsets[4][2]{ { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+		for (int py{}; py < m_RenderHeight; ++py)
+		{
+			//Skip to the first pixel that was not rasterized this frame
+			for (int px{ static_cast<int>((py + m_FrameIndex + 1) & 1) }; px < m_RenderWidth; px += 2)
+			{
+				const int pixelIndex{ px + py * m_RenderWidth };
+
+				ColorRGB spatialColor{};
+				ColorRGB minColor{ FLT_MAX, FLT_MAX, FLT_MAX };
+				ColorRGB maxColor{};
+				float minDepth{ FLT_MAX };
+				int nrNeighbours{};
+
+				for (const auto& offset : neighbourOffsets)
+				{
+					const int nx{ px + offset[0] };
+					const int ny{ py + offset[1] };
+					if (nx < 0 || nx >= m_RenderWidth || ny < 0 || ny >= m_RenderHeight)
+						continue;
+
+					const int neighbourIndex{ nx + ny * m_RenderWidth };
+
+					uint8_t r, g, b;
+					SDL_GetRGB(m_pRenderBufferPixels[neighbourIndex], m_pBackBuffer->format, &r, &g, &b);
+					const ColorRGB color{ r / 255.f, g / 255.f, b / 255.f };
+
+					spatialColor += color;
+					minColor = { std::min(minColor.r, color.r), std::min(minColor.g, color.g), std::min(minColor.b, color.b) };
+					maxColor = { std::max(maxColor.r, color.r), std::max(maxColor.g, color.g), std::max(maxColor.b, color.b) };
+					minDepth = std::min(minDepth, m_pDepthBufferPixels[neighbourIndex]);
+					++nrNeighbours;
+				}
+
+				//Only background around this pixel, the clear color is already correct
+				if (minDepth == FLT_MAX || nrNeighbours == 0)
+					continue;
+
+				ColorRGB finalColor{ spatialColor / static_cast<float>(nrNeighbours) };
+
+				if (useHistory)
+				{
+					const Vector4 ndcPosition{
+						2.f * px / m_RenderWidth - 1.f,
+						1.f - 2.f * py / m_RenderHeight,
+						minDepth,
+						1.f };
+
+					const Vector4 previousPosition{ reprojectionMatrix.TransformPoint(ndcPosition) };
+
+					const int previousX{ static_cast<int>((previousPosition.x / previousPosition.w + 1.f) * 0.5f * m_RenderWidth + 0.5f) };
+					const int previousY{ static_cast<int>((1.f - previousPosition.y / previousPosition.w) * 0.5f * m_RenderHeight + 0.5f) };
+
+					if (previousPosition.w > 0.f && previousX >= 0 && previousX < m_RenderWidth && previousY >= 0 && previousY < m_RenderHeight)
+					{
+						uint8_t r, g, b;
+						SDL_GetRGB(m_HistoryPixels[previousX + previousY * m_RenderWidth], m_pBackBuffer->format, &r, &g, &b);
+
+						//Clamp the history to the neighbourhood so disoccluded or moving pixels do not ghost
+						finalColor = {
+							Clamp(r / 255.f, minColor.r, maxColor.r),
+							Clamp(g / 255.f, minColor.g, maxColor.g),
+							Clamp(b / 255.f, minColor.b, maxColor.b) };
+					}
+				}
+
+				m_pRenderBufferPixels[pixelIndex] = SDL_MapRGB(m_pBackBuffer->format,
+					static_cast<uint8_t>(finalColor.r * 255),
+					static_cast<uint8_t>(finalColor.g * 255),
+					static_cast<uint8_t>(finalColor.b * 255));
+				m_pDepthBufferPixels[pixelIndex] = minDepth;
+			}
+		}
+	}
+
+	void Renderer::StoreHistory()
+	{
+		std::copy_n(m_pRenderBufferPixels, m_RenderWidth * m_RenderHeight, m_HistoryPixels.begin());
+		m_HistoryWidth = m_RenderWidth;
+		m_HistoryHeight = m_RenderHeight;
+		m_PreviousViewProjectionMatrix = m_Camera.viewProjectionMatrix;
+		m_IsHistoryValid = true;
+	}
+
+	ShadingRate Renderer::GetPixelShadingRate(int px, int py) const
+	{
+		if (!m_UseVariableRateShading)
+			return ShadingRate::Rate1x1;
+
+		if (m_CurrentMeshShadingRate != ShadingRate::Adaptive)
+			return m_CurrentMeshShadingRate;
+
+		const size_t tileIndex{ static_cast<size_t>(px / m_ShadingRateTileSize + (py / m_ShadingRateTileSize) * m_ShadingRateTilesX) };
+		if (tileIndex >= m_ShadingRateImage.size())
+			return ShadingRate::Rate1x1;
+
+		return m_ShadingRateImage[tileIndex];
+	}
+
+	void Renderer::UpdateShadingRateImage()
+	{
+		if (!m_UseVariableRateShading)
+			return;
+
+		const int tilesX{ (m_RenderWidth + m_ShadingRateTileSize - 1) / m_ShadingRateTileSize };
+		const int tilesY{ (m_RenderHeight + m_ShadingRateTileSize - 1) / m_ShadingRateTileSize };
+		m_ShadingRateTilesX = tilesX;
+		m_ShadingRateImage.resize(static_cast<size_t>(tilesX * tilesY));
+
+		//Distance past which a tile is shaded one step coarser
+		const float farDistance{ 60.f };
+		const float nearPlane{ m_Camera.nearPlane };
+		const float farPlane{ m_Camera.farPlane };
+
+		for (int ty{}; ty < tilesY; ++ty)
+		{
+			for (int tx{}; tx < tilesX; ++tx)
+			{
+				const int startX{ tx * m_ShadingRateTileSize };
+				const int startY{ ty * m_ShadingRateTileSize };
+				const int endX{ std::min(startX + m_ShadingRateTileSize, m_RenderWidth) };
+				const int endY{ std::min(startY + m_ShadingRateTileSize, m_RenderHeight) };
+
+				float minLuminance{ FLT_MAX };
+				float maxLuminance{ 0.f };
+				float minDepth{ FLT_MAX };
+
+				//Every other pixel is enough to estimate the contrast of the tile
+				for (int py{ startY }; py < endY; py += 2)
+				{
+					for (int px{ startX }; px < endX; px += 2)
+					{
+						const int pixelIndex{ px + py * m_RenderWidth };
+
+						uint8_t r, g, b;
+						SDL_GetRGB(m_pRenderBufferPixels[pixelIndex], m_pBackBuffer->format, &r, &g, &b);
+						const float luminance{ (0.2126f * r + 0.7152f * g + 0.0722f * b) / 255.f };
+
+						minLuminance = std::min(minLuminance, luminance);
+						maxLuminance = std::max(maxLuminance, luminance);
+						minDepth = std::min(minDepth, m_pDepthBufferPixels[pixelIndex]);
+					}
+				}
+
+				ShadingRate& rate{ m_ShadingRateImage[tx + ty * tilesX] };
+
+				if (minDepth == FLT_MAX)
+				{
+					rate = ShadingRate::Rate4x4;
+					continue;
+				}
+
+				const float contrast{ maxLuminance - minLuminance };
+				if (contrast < 0.02f)
+					rate = ShadingRate::Rate4x4;
+				else if (contrast < 0.05f)
+					rate = ShadingRate::Rate2x2;
+				else if (contrast < 0.1f)
+					rate = ShadingRate::Rate2x1;
+				else
+					rate = ShadingRate::Rate1x1;
+
+				//Depth buffer holds the non linear ndc depth, linearize it before comparing distances
+				const float viewDistance{ (nearPlane * farPlane) / (farPlane - minDepth * (farPlane - nearPlane)) };
+				if (viewDistance > farDistance && rate != ShadingRate::Rate4x4)
+				{
+					rate = static_cast<ShadingRate>(static_cast<int>(rate) + 1);
+				}
+			}
+		}
+	}
+
+	void Renderer::UpdateResolutionScale(float rasterTime)
+	{
+		if (!m_UseDynamicResolution || rasterTime <= 0.f)
+			return;
+
+		//Shading cost scales with the pixel count, so with the square of the scale
+		const float idealScale{ m_ResolutionScale * sqrtf(m_FrameTimeBudget / rasterTime) };
+
+		if (rasterTime > m_FrameTimeBudget)
+		{
+			//Over budget, drop straight to the estimated scale
+			m_ResolutionScale = idealScale;
+		}
+		else if (rasterTime < 0.85f * m_FrameTimeBudget)
+		{
+			//Comfortably under budget, creep back up to avoid oscillating around the budget
+			m_ResolutionScale = Lerpf(m_ResolutionScale, idealScale, 0.1f);
+		}
+
+		m_ResolutionScale = Clamp(m_ResolutionScale, m_MinResolutionScale, 1.f);
+	}
+
+	void Renderer::UpscaleToBackBuffer()
+	{
+		if (m_RenderWidth == m_Width && m_RenderHeight == m_Height)
+		{
+			std::copy_n(m_pRenderBufferPixels, m_Width * m_Height, m_pBackBufferPixels);
+			return;
+		}
+
+		//Nearest neighbour with 16.16 fixed point steps, the source column per target column is the same for every row
+		const uint32_t stepX{ (static_cast<uint32_t>(m_RenderWidth) << 16) / m_Width };
+		const uint32_t stepY{ (static_cast<uint32_t>(m_RenderHeight) << 16) / m_Height };
+
+		for (int px{}; px < m_Width; ++px)
+		{
+			m_UpscaleColumns[px] = static_cast<int>((px * stepX) >> 16);
+		}
+
+		for (int py{}; py < m_Height; ++py)
+		{
+			const uint32_t* pSourceRow{ m_pRenderBufferPixels + ((py * stepY) >> 16) * m_RenderWidth };
+			uint32_t* pTargetRow{ m_pBackBufferPixels + py * m_Width };
+
+			for (int px{}; px < m_Width; ++px)
+			{
+				pTargetRow[px] = pSourceRow[m_UpscaleColumns[px]];
+			}
+		}
 	}
-}
+}
\ No newline at end of file
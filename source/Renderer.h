@@ -6,6 +6,10 @@ struct SDL_Surface;
 
 #include "Camera.h"
 #include "DataStructures.h"
+#include "ThreadPool.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
 
 namespace dae
 {
@@ -43,13 +47,6 @@ namespace dae
 			Front,
 			None,
 		};
-
-		enum class SampleState
-		{
-			Point,
-			Linear,
-			Anisotropic
-		};
 #pragma endregion
 
 	public:
@@ -61,8 +58,8 @@ namespace dae
 		Renderer& operator=(const Renderer&) = delete;
 		Renderer& operator=(Renderer&&) noexcept = delete;
 
-		void Update(const Timer* pTimer);
-		void Render();
+		void Update(float deltaTime);
+		void Render(float interpolationAlpha);
 
 
 		void ToggleSampleState();
@@ -75,6 +72,13 @@ namespace dae
 		void ToggleCullMode();
 		void ToggleFire();
 		void ToggleDrawBoundingBox();
+		void ToggleDynamicResolution();
+		void ToggleVariableRateShading();
+		void ToggleCheckerboard();
+		void ToggleInstancing();
+		void ToggleTopDownView();
+
+		void SetFrameTimeBudget(float milliseconds);
 
 	private:
 
@@ -91,15 +95,23 @@ namespace dae
 		bool m_UseUniformColor{ false };
 		bool m_DrawBoundingBox{ false };
 
+		bool m_UseInstancing{ false };
+		static constexpr int m_InstanceGridSize{ 5 };
+		static constexpr float m_InstanceSpacing{ 40.f };
+
 		std::vector<Mesh*> m_pMeshes{};
+		std::vector<Material*> m_pMaterials{};
 
 		Camera m_Camera;
 
+		ThreadPool m_ThreadPool{};
+
 		RenderMode m_CurrentRenderMode{ RenderMode::Hardware };
 		CullMode m_CurrentCullMode{ CullMode::Back };
 
 		void InitMeshes();
-		Matrix MakeWorldMatrix();
+		Material* CreateMaterial(const Material& material);
+		Transform MakeStartTransform();
 
 		//DIRECTX
 		ID3D11Device* m_pDevice{ nullptr };
@@ -113,15 +125,22 @@ namespace dae
 		ID3D11SamplerState* m_pSampler;
 		ID3D11RasterizerState* m_pRasterizer;
 
-		Texture* m_pDiffuseMap{ };
-		Texture* m_pFireDiffuseMap{ };
-		Texture* m_pSpecularMap{ };
-		Texture* m_pNormalMap{ };
-		Texture* m_pGlossinessMap{ };
+		TextureCache m_TextureCache{};
+
+		std::shared_ptr<Texture> m_pDiffuseMap{ };
+		std::shared_ptr<Texture> m_pFireDiffuseMap{ };
+		std::shared_ptr<Texture> m_pSpecularMap{ };
+		std::shared_ptr<Texture> m_pNormalMap{ };
+		std::shared_ptr<Texture> m_pGlossinessMap{ };
 
 
 
 		SampleState m_SampleState{ SampleState::Point };
+		static constexpr TexelLayout m_SoftwareTexelLayout{ TexelLayout::Tiled };
+
+		//Software texel memory of the textures loaded from baked containers, textures decoded from images are always fully resident
+		static constexpr size_t m_TextureBudget{ 64 * 1024 * 1024 };
+		TextureStreamer m_TextureStreamer{ m_TextureBudget, m_ThreadPool };
 		bool m_RenderFire{ true };
 
 		void InitHardware() ;
@@ -136,19 +155,148 @@ namespace dae
 		SDL_Surface* m_pBackBuffer{ nullptr };
 		uint32_t* m_pBackBufferPixels{};
 
+		//Internal resolution the software path rasterizes at, upscaled into the back buffer
+		uint32_t* m_pRenderBufferPixels{};
+		int m_RenderWidth{};
+		int m_RenderHeight{};
+
 		float* m_pDepthBufferPixels{};
 
+		//Vertices per job of the parallel vertex stage
+		static constexpr size_t m_VertexChunkSize{ 1024 };
+		std::vector<Vector2> m_ScreenVertices{};
+
+		//SoA scratch for the batch position transform, ndc after the perspective divide
+		std::vector<float> m_PositionsX{};
+		std::vector<float> m_PositionsY{};
+		std::vector<float> m_PositionsZ{};
+		std::vector<float> m_PositionsW{};
+		std::vector<float> m_ScreenX{};
+		std::vector<float> m_ScreenY{};
+
+		//A camera and the color and depth buffers it is rasterized into
+		struct SoftwareView
+		{
+			Matrix invViewMatrix{};
+			Matrix viewProjectionMatrix{};
+			Frustum frustum{};
+
+			uint32_t* pColorPixels{};
+			float* pDepthPixels{};
+			int width{};
+			int height{};
+
+			//Only the main view gets checkerboard, variable rate shading and the transparent pass
+			bool isMainView{ false };
+		};
+		std::vector<SoftwareView> m_Views{};
+		const SoftwareView* m_pCurrentView{};
+
+		//Debug view from above, rendered at a fraction of the resolution into the top right corner
+		bool m_ShowTopDownView{ false };
+		static constexpr int m_TopDownViewDivisor{ 4 };
+		static constexpr float m_TopDownViewHeight{ 90.f };
+		static constexpr float m_TopDownViewDistance{ 40.f };
+		std::vector<uint32_t> m_TopDownColorPixels{};
+		std::vector<float> m_TopDownDepthPixels{};
+
+		//One entry per mesh instance that survived frustum culling, rebuilt every frame
+		struct DrawItem
+		{
+			Mesh* pMesh{};
+			const Material* pMaterial{};
+			Matrix worldMatrix{};
+			Matrix worldViewProjectionMatrix{};
+			uint64_t sortKey{};
+		};
+		std::vector<DrawItem> m_DrawList{};
+
+		const Material* m_pCurrentMaterial{};
+		CullMode m_CurrentMeshCullMode{ CullMode::Back };
+
+		//Transparent pass, triangles are binned into screen tiles that are sorted and blended in parallel
+		struct TransparentTriangle
+		{
+			Vertex_Out vertices[3]{};
+			Vector2 screenPositions[3]{};
+			const Material* pMaterial{};
+			float viewDepth{};
+		};
+		static constexpr int m_TransparentTileSize{ 32 };
+		std::vector<TransparentTriangle> m_TransparentTriangles{};
+		std::vector<std::vector<uint32_t>> m_TransparentTileBins{};
+
+		//Index buffer offsets of the triangles that survived setup, three per triangle
+		std::vector<int> m_VisibleTriangles{};
+
+		//Post-transform cache, a vertex's attributes are computed for the current view when its stamp matches
+		std::vector<uint32_t> m_VertexAttributeStamps{};
+		uint32_t m_VertexAttributeStamp{};
+
+		//View independent attributes, computed once per draw item and shared by every view
+		std::vector<Vector3> m_WorldPositions{};
+		std::vector<uint32_t> m_WorldAttributeStamps{};
+		uint32_t m_WorldAttributeStamp{};
+
+		bool m_UseDynamicResolution{ true };
+		float m_ResolutionScale{ 1.f };
+		float m_FrameTimeBudget{ 16.6f };
+		const float m_MinResolutionScale{ 0.25f };
+		std::vector<int> m_UpscaleColumns{};
+
+		//Variable rate shading, one rate per tile computed from the previous frame
+		bool m_UseVariableRateShading{ false };
+		static constexpr int m_ShadingRateTileSize{ 16 };
+		int m_ShadingRateTilesX{};
+		std::vector<ShadingRate> m_ShadingRateImage{};
+		ShadingRate m_CurrentMeshShadingRate{ ShadingRate::Adaptive };
+
+		//Colors shaded for a coarse block, valid for the triangle whose stamp matches
+		std::vector<ColorRGB> m_CoarseShadeColors{};
+		std::vector<uint32_t> m_CoarseShadeStamps{};
+		uint32_t m_TriangleStamp{};
+
+		//Checkerboard rendering, half the pixels are rasterized per frame and the rest reconstructed
+		bool m_UseCheckerboard{ false };
+		uint32_t m_FrameIndex{};
+		std::vector<uint32_t> m_HistoryPixels{};
+		int m_HistoryWidth{};
+		int m_HistoryHeight{};
+		bool m_IsHistoryValid{ false };
+		Matrix m_PreviousViewProjectionMatrix{};
+
 		BufferMode m_CurrentBufferMode{ BufferMode::Texture };
 		ColorMode m_CurrentColorMode{ ColorMode::Combined };
 
 		void InitSoftware();
 
-		void VertexTransformationFunction();
+		void BuildDrawList();
+		static uint64_t MakeSortKey(const Material& material, float viewDepth);
+
+		SoftwareView MakeTopDownView();
+		void CompositeTopDownView(const SoftwareView& view);
+
+		void BeginWorldStage(Mesh& mesh);
+		void VertexTransformationFunction(Mesh& mesh, const Matrix& meshWorldMatrix, const Matrix& worldViewProjectionMatrix);
+		void SetupTriangles(const Mesh& mesh, const Matrix& worldMatrix);
+		bool IsMeshletCulled(const Meshlet& meshlet, const Matrix& worldMatrix, const Vector3& cameraPosition) const;
+		bool IsTriangleVisible(uint32_t vertex0, uint32_t vertex1, uint32_t vertex2) const;
 		void RenderTraingle(int i0, int i1, int i2, std::vector<Vector2>& screenVertices,
 			std::vector<Vertex_Out>& verticesOut, const std::vector<uint32_t>& indeces);
 		bool PositionOutsideFrustrum(const Vector4& v) const;
-		ColorRGB PixelShading(const Vertex_Out& v);
+		ColorRGB PixelShading(const Vertex_Out& v, const Vector2& uvDdx, const Vector2& uvDdy, const Material& material);
+		void RenderTransparents(size_t firstItem);
+		void BlendTransparentTriangle(const TransparentTriangle& triangle, int minX, int minY, int maxX, int maxY);
 		void RenderSoftware();
 
+		void ReconstructCheckerboard();
+		void StoreHistory();
+
+		ShadingRate GetPixelShadingRate(int px, int py) const;
+		void UpdateShadingRateImage();
+
+		void UpdateResolutionScale(float rasterTime);
+		void UpscaleToBackBuffer();
+
 	};
 }
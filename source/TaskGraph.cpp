@@ -0,0 +1,105 @@
+#include "pch.h"
+#include "TaskGraph.h"
+#include <atomic>
+#include <chrono>
+#include <cassert>
+
+namespace dae
+{
+	TaskGraph::TaskId TaskGraph::AddTask(const std::string& name, std::function<void()> job, std::initializer_list<TaskId> dependencies)
+	{
+		const TaskId id{ m_Tasks.size() };
+		for (TaskId dependency : dependencies)
+		{
+			assert(dependency < id && "Dependencies have to be added before the tasks using them.");
+			m_Tasks[dependency].dependents.push_back(id);
+		}
+
+		m_Tasks.push_back({ name, std::move(job), dependencies });
+		return id;
+	}
+
+	void TaskGraph::Run(ThreadPool& threadPool)
+	{
+		using Clock = std::chrono::steady_clock;
+		const Clock::time_point startTime{ Clock::now() };
+		const auto millisecondsSinceStart = [startTime]()
+		{
+			return std::chrono::duration<float, std::milli>(Clock::now() - startTime).count();
+		};
+
+		std::vector<std::atomic<size_t>> nrPendingDependencies(m_Tasks.size());
+		for (size_t i{}; i < m_Tasks.size(); ++i)
+		{
+			nrPendingDependencies[i] = m_Tasks[i].dependencies.size();
+		}
+
+		std::mutex doneMutex{};
+		std::condition_variable doneCondition{};
+		size_t nrTasksDone{};
+
+		//The last dependency to finish schedules its dependent, so every task is enqueued exactly once
+		std::function<void(TaskId)> schedule{};
+		schedule = [&](TaskId id)
+		{
+			threadPool.Enqueue([&, id]()
+				{
+					Task& task{ m_Tasks[id] };
+					task.startTime = millisecondsSinceStart();
+					task.job();
+					task.duration = millisecondsSinceStart() - task.startTime;
+
+					for (TaskId dependent : task.dependents)
+					{
+						if (--nrPendingDependencies[dependent] == 0)
+						{
+							schedule(dependent);
+						}
+					}
+
+					std::lock_guard<std::mutex> lock{ doneMutex };
+					++nrTasksDone;
+					doneCondition.notify_one();
+				});
+		};
+
+		for (TaskId id{}; id < m_Tasks.size(); ++id)
+		{
+			if (m_Tasks[id].dependencies.empty())
+			{
+				schedule(id);
+			}
+		}
+
+		std::unique_lock<std::mutex> lock{ doneMutex };
+		doneCondition.wait(lock, [&]() { return nrTasksDone == m_Tasks.size(); });
+
+		m_WallTime = millisecondsSinceStart();
+	}
+
+	void TaskGraph::PrintTimings() const
+	{
+		//Dependencies always have a lower id, so one pass in order finds the longest chain ending in each task
+		std::vector<float> chainTimes(m_Tasks.size());
+		float criticalPath{};
+		float totalTime{};
+		for (size_t i{}; i < m_Tasks.size(); ++i)
+		{
+			float longestDependency{};
+			for (TaskId dependency : m_Tasks[i].dependencies)
+			{
+				longestDependency = std::max(longestDependency, chainTimes[dependency]);
+			}
+
+			chainTimes[i] = longestDependency + m_Tasks[i].duration;
+			criticalPath = std::max(criticalPath, chainTimes[i]);
+			totalTime += m_Tasks[i].duration;
+		}
+
+		std::cout << "Startup: " << m_WallTime << " ms, longest chain " << criticalPath << " ms, all tasks " << totalTime << " ms\n";
+		for (const Task& task : m_Tasks)
+		{
+			std::cout << "  " << task.name << ": started at " << task.startTime << " ms, took " << task.duration << " ms\n";
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <functional>
+#include "ThreadPool.h"
+
+namespace dae
+{
+	//One shot dependency graph on top of the thread pool, each task starts as soon as everything it depends on is done
+	class TaskGraph final
+	{
+	public:
+		using TaskId = size_t;
+
+		//Dependencies have to be added first, which also keeps the graph free of cycles
+		TaskId AddTask(const std::string& name, std::function<void()> job, std::initializer_list<TaskId> dependencies = {});
+
+		//Blocks the calling thread until every task has run
+		void Run(ThreadPool& threadPool);
+
+		//Wall time, the sum of all tasks and the longest dependency chain, then every task on its own
+		void PrintTimings() const;
+
+	private:
+		struct Task
+		{
+			std::string name{};
+			std::function<void()> job{};
+			std::vector<TaskId> dependencies{};
+			std::vector<TaskId> dependents{};
+
+			//Milliseconds since the start of Run
+			float startTime{};
+			float duration{};
+		};
+
+		std::vector<Task> m_Tasks{};
+		float m_WallTime{};
+	};
+}
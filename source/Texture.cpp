@@ -1,24 +1,428 @@
 #include "pch.h"
 #include "Texture.h"
 #include "Vector2.h"
+#include "MappedFile.h"
+#include "TextureFilter.h"
 #include <SDL_image.h>
 #include <cassert>
+#include <fstream>
+#include <atomic>
+#include <filesystem>
+#include <immintrin.h>
 
 namespace dae
 {
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	namespace
 	{
+		constexpr float ToFloat{ 1.f / 255.f };
+
+		ColorRGB DecodeTexel(uint32_t texel)
+		{
+			return { (texel & 0xFF) * ToFloat, ((texel >> 8) & 0xFF) * ToFloat, ((texel >> 16) & 0xFF) * ToFloat };
+		}
+
+		bool IsPowerOfTwo(int value)
+		{
+			return (value & (value - 1)) == 0;
+		}
+
+		//Levels down to and including 1x1
+		int GetFullChainLength(uint32_t width, uint32_t height)
+		{
+			int nrLevels{ 1 };
+			for (uint32_t size{ std::max(width, height) }; size > 1; size /= 2)
+			{
+				++nrLevels;
+			}
+			return nrLevels;
+		}
+
+#pragma region BlockDecoding
+		uint32_t MakeTexel(uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+		{
+			return r | g << 8 | b << 16 | a << 24;
+		}
+
+		uint16_t ReadUint16(const uint8_t* pBytes)
+		{
+			return static_cast<uint16_t>(pBytes[0] | pBytes[1] << 8);
+		}
+
+		uint32_t ReadUint32(const uint8_t* pBytes)
+		{
+			return pBytes[0] | pBytes[1] << 8 | pBytes[2] << 16 | static_cast<uint32_t>(pBytes[3]) << 24;
+		}
+
+		//BC1 color block, only alpha is written with the 1 bit punch through when allowed
+		void DecodeColorBlock(const uint8_t* pBlock, bool allowPunchThrough, uint32_t texels[16])
+		{
+			const uint16_t color0{ ReadUint16(pBlock) };
+			const uint16_t color1{ ReadUint16(pBlock + 2) };
+			const uint32_t indices{ ReadUint32(pBlock + 4) };
+
+			//565 expanded to 8 bits by repeating the high bits
+			const auto expand = [](uint16_t color, uint32_t& r, uint32_t& g, uint32_t& b)
+			{
+				r = (color >> 11) & 0x1F;
+				g = (color >> 5) & 0x3F;
+				b = color & 0x1F;
+				r = (r << 3) | (r >> 2);
+				g = (g << 2) | (g >> 4);
+				b = (b << 3) | (b >> 2);
+			};
+
+			uint32_t r[4]{};
+			uint32_t g[4]{};
+			uint32_t b[4]{};
+			uint32_t a[4]{ 255, 255, 255, 255 };
+			expand(color0, r[0], g[0], b[0]);
+			expand(color1, r[1], g[1], b[1]);
+
+			if (color0 > color1 || !allowPunchThrough)
+			{
+				for (uint32_t* channel : { r, g, b })
+				{
+					channel[2] = (2 * channel[0] + channel[1] + 1) / 3;
+					channel[3] = (channel[0] + 2 * channel[1] + 1) / 3;
+				}
+			}
+			else
+			{
+				for (uint32_t* channel : { r, g, b })
+				{
+					channel[2] = (channel[0] + channel[1]) / 2;
+				}
+				a[3] = 0;
+			}
+
+			for (int i{}; i < 16; ++i)
+			{
+				const uint32_t index{ (indices >> (i * 2)) & 0x3 };
+				texels[i] = MakeTexel(r[index], g[index], b[index], a[index]);
+			}
+		}
+
+		//BC4 style single channel block, shared by the BC3 alpha and both BC5 channels
+		void DecodeChannelBlock(const uint8_t* pBlock, uint32_t values[16])
+		{
+			const uint32_t value0{ pBlock[0] };
+			const uint32_t value1{ pBlock[1] };
+
+			uint32_t palette[8]{ value0, value1 };
+			if (value0 > value1)
+			{
+				for (uint32_t i{ 1 }; i < 7; ++i)
+				{
+					palette[i + 1] = ((7 - i) * value0 + i * value1 + 3) / 7;
+				}
+			}
+			else
+			{
+				for (uint32_t i{ 1 }; i < 5; ++i)
+				{
+					palette[i + 1] = ((5 - i) * value0 + i * value1 + 2) / 5;
+				}
+				palette[6] = 0;
+				palette[7] = 255;
+			}
+
+			//48 bits of 3 bit indices
+			uint64_t indices{};
+			for (int i{}; i < 6; ++i)
+			{
+				indices |= static_cast<uint64_t>(pBlock[2 + i]) << (i * 8);
+			}
+
+			for (int i{}; i < 16; ++i)
+			{
+				values[i] = palette[(indices >> (i * 3)) & 0x7];
+			}
+		}
+
+		void DecodeBlock(TexelFormat format, const uint8_t* pBlock, uint32_t texels[16])
+		{
+			switch (format)
+			{
+			case TexelFormat::BC1:
+				DecodeColorBlock(pBlock, true, texels);
+				break;
+			case TexelFormat::BC3:
+			{
+				uint32_t alpha[16]{};
+				DecodeChannelBlock(pBlock, alpha);
+				DecodeColorBlock(pBlock + 8, false, texels);
+				for (int i{}; i < 16; ++i)
+				{
+					texels[i] = (texels[i] & 0x00FFFFFF) | alpha[i] << 24;
+				}
+			}
+			break;
+			case TexelFormat::BC5:
+			default:
+			{
+				//Two channel normal maps, blue is rebuilt as the z of the unit normal
+				uint32_t red[16]{};
+				uint32_t green[16]{};
+				DecodeChannelBlock(pBlock, red);
+				DecodeChannelBlock(pBlock + 8, green);
+				for (int i{}; i < 16; ++i)
+				{
+					const float x{ red[i] * ToFloat * 2.f - 1.f };
+					const float y{ green[i] * ToFloat * 2.f - 1.f };
+					const float z{ std::sqrt(std::max(1.f - x * x - y * y, 0.f)) };
+					texels[i] = MakeTexel(red[i], green[i], static_cast<uint32_t>((z * 0.5f + 0.5f) * 255.f + 0.5f), 255);
+				}
+			}
+			break;
+			}
+		}
+
+		//Direct mapped per thread, so the sampling threads never share or lock it
+		struct DecodedBlock
+		{
+			const uint8_t* pBlock{};
+			uint32_t cacheId{};
+			uint32_t texels[16]{};
+		};
+
+		constexpr int NrDecodedBlocks{ 64 };
+		thread_local DecodedBlock g_DecodedBlocks[NrDecodedBlocks]{};
+
+		std::atomic<uint32_t> g_NextCacheId{ 1 };
+#pragma endregion
+
+#pragma region DDS
+		constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+		{
+			return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+		}
+
+		struct DdsHeader
+		{
+			uint32_t size;
+			uint32_t flags;
+			uint32_t height;
+			uint32_t width;
+			uint32_t pitchOrLinearSize;
+			uint32_t depth;
+			uint32_t mipMapCount;
+			uint32_t reserved1[11];
+			uint32_t pixelFormatSize;
+			uint32_t pixelFormatFlags;
+			uint32_t fourCC;
+			uint32_t rgbBitCount;
+			uint32_t masks[4];
+			uint32_t caps[4];
+			uint32_t reserved2;
+		};
+		static_assert(sizeof(DdsHeader) == 124);
+
+		//Only the first member of the DX10 extension matters here
+		constexpr size_t DdsDx10HeaderSize{ 20 };
+
+		//fourCC is only meaningful with this pixel format flag set
+		constexpr uint32_t DdsPixelFormatFourCC{ 0x4 };
+
+		bool ToTexelFormat(uint32_t fourCC, uint32_t dxgiFormat, TexelFormat& format)
+		{
+			//The _SRGB variants (72 and 78) are rejected, both render paths treat texels as UNORM like the .png textures
+			if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+			{
+				switch (dxgiFormat)
+				{
+				case 71: format = TexelFormat::BC1; return true;
+				case 77: format = TexelFormat::BC3; return true;
+				case 83: format = TexelFormat::BC5; return true;
+				default: return false;
+				}
+			}
+
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+				format = TexelFormat::BC1;
+			else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+				format = TexelFormat::BC3;
+			else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+				format = TexelFormat::BC5;
+			else
+				return false;
+
+			return true;
+		}
+
+		DXGI_FORMAT ToDxgiFormat(TexelFormat format)
+		{
+			switch (format)
+			{
+			case TexelFormat::BC1: return DXGI_FORMAT_BC1_UNORM;
+			case TexelFormat::BC3: return DXGI_FORMAT_BC3_UNORM;
+			case TexelFormat::BC5: return DXGI_FORMAT_BC5_UNORM;
+			default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+		}
+
+#pragma endregion
+
+#pragma region Container
+		//Level data starts cache line aligned, the mapping itself starts on a page
+		constexpr uint32_t ContainerMagic{ MakeFourCC('D', 'T', 'E', 'X') };
+		constexpr uint32_t ContainerVersion{ 1 };
+		constexpr int MaxContainerMipLevels{ 16 };
+		constexpr size_t ContainerAlignment{ 64 };
+
+		struct ContainerHeader
+		{
+			uint32_t magic;
+			uint32_t version;
+			uint32_t format;
+			uint32_t layout;
+			uint32_t width;
+			uint32_t height;
+			uint32_t nrMipLevels;
+			uint32_t reserved;
+			uint64_t mipOffsets[MaxContainerMipLevels];
+			uint64_t mipSizes[MaxContainerMipLevels];
+		};
+
+		size_t AlignUp(size_t value, size_t alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		//Any filesystem error counts as stale, each call reports its own
+		bool IsBakeUpToDate(const std::string& path, const std::string& bakedPath)
+		{
+			std::error_code existsError{};
+			if (!std::filesystem::exists(bakedPath, existsError) || existsError)
+				return false;
+
+			std::error_code bakedTimeError{};
+			std::error_code sourceTimeError{};
+			const std::filesystem::file_time_type bakedTime{ std::filesystem::last_write_time(bakedPath, bakedTimeError) };
+			const std::filesystem::file_time_type sourceTime{ std::filesystem::last_write_time(path, sourceTimeError) };
+			return !bakedTimeError && !sourceTimeError && bakedTime >= sourceTime;
+		}
+
+		bool HasExtension(const std::string& path, const std::string& extension)
+		{
+			if (path.size() < extension.size())
+				return false;
+
+			return std::equal(extension.rbegin(), extension.rend(), path.rbegin(), [](char a, char b)
+				{
+					return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+				});
+		}
+#pragma endregion
 	}
 
-	Texture::~Texture()
+	Texture::Texture() = default;
+
+	Texture::Texture(SDL_Surface* pSurface)
+	{
+		//Sizes of the whole chain first, so the storage is allocated once and the level pointers stay valid
+		size_t nrTexels{};
+		int width{ pSurface->w };
+		int height{ pSurface->h };
+		while (true)
+		{
+			m_MipLevels.push_back({ nullptr, width, height, IsPowerOfTwo(width) && IsPowerOfTwo(height), width - 1, height - 1 });
+			nrTexels += static_cast<size_t>(width) * height;
+
+			if (width == 1 && height == 1)
+				break;
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		m_TexelStorage.resize(nrTexels);
+
+		size_t offset{};
+		for (MipLevel& level : m_MipLevels)
+		{
+			level.pTexels = m_TexelStorage.data() + offset;
+			offset += static_cast<size_t>(level.width) * level.height;
+		}
+
+		//Expects SDL_PIXELFORMAT_RGBA32, the rows are copied without their padding
+		const MipLevel& topLevel{ m_MipLevels.front() };
+		for (int y{}; y < topLevel.height; ++y)
+		{
+			const uint32_t* pRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pSurface->pixels) + y * pSurface->pitch) };
+			std::copy_n(pRow, topLevel.width, m_TexelStorage.data() + static_cast<size_t>(y) * topLevel.width);
+		}
+
+		BuildMipChain();
+	}
+
+	Texture::Texture(TexelFormat format, int width, int height, int nrMipLevels, std::vector<uint8_t>&& blocks)
+		: m_Layout{ TexelLayout::Tiled }
+		, m_BlockStorage{ std::move(blocks) }
+		, m_Format{ format }
+		, m_BlockBytes{ format == TexelFormat::BC1 ? 8 : 16 }
+		, m_CacheId{ g_NextCacheId++ }
 	{
-		if (m_pSurface)
+		//Blocks already are 4x4 tiles, the levels just point into the file's data
+		size_t offset{};
+		for (int i{}; i < nrMipLevels; ++i)
 		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
+			MipLevel level{ nullptr, width, height, IsPowerOfTwo(width) && IsPowerOfTwo(height), width - 1, height - 1 };
+			level.blocksPerRow = (width + BlockSize - 1) / BlockSize;
+			level.pBlocks = m_BlockStorage.data() + offset;
+			m_MipLevels.push_back(level);
+
+			const int blocksPerColumn{ (height + BlockSize - 1) / BlockSize };
+			offset += static_cast<size_t>(level.blocksPerRow) * blocksPerColumn * m_BlockBytes;
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
 		}
+	}
+
+	void Texture::BuildMipChain()
+	{
+		//2x2 box filter of the level above, odd sizes repeat their last row or column
+		for (size_t i{ 1 }; i < m_MipLevels.size(); ++i)
+		{
+			const MipLevel& source{ m_MipLevels[i - 1] };
+			const MipLevel& destination{ m_MipLevels[i] };
+			uint32_t* pDestination{ m_TexelStorage.data() + (destination.pTexels - m_TexelStorage.data()) };
+
+			for (int y{}; y < destination.height; ++y)
+			{
+				const int y0{ std::min(y * 2, source.height - 1) };
+				const int y1{ std::min(y * 2 + 1, source.height - 1) };
+
+				for (int x{}; x < destination.width; ++x)
+				{
+					const int x0{ std::min(x * 2, source.width - 1) };
+					const int x1{ std::min(x * 2 + 1, source.width - 1) };
+
+					const uint32_t texels[4]{
+						source.pTexels[x0 + y0 * source.width],
+						source.pTexels[x1 + y0 * source.width],
+						source.pTexels[x0 + y1 * source.width],
+						source.pTexels[x1 + y1 * source.width] };
+
+					uint32_t averaged{};
+					for (int channel{}; channel < 4; ++channel)
+					{
+						const int shift{ channel * 8 };
+						uint32_t sum{ 2 };
+						for (uint32_t texel : texels)
+						{
+							sum += (texel >> shift) & 0xFF;
+						}
+						averaged |= (sum / 4) << shift;
+					}
+
+					pDestination[x + y * destination.width] = averaged;
+				}
+			}
+		}
+	}
+
+	Texture::~Texture()
+	{
 		if (m_pShaderResourceView)
 		{
 			m_pShaderResourceView->Release();
@@ -30,20 +434,483 @@ namespace dae
 		}
 	}
 
-	Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice)
+	void Texture::ConvertToTiled()
+	{
+		//Sizes of every padded level first, then each level is copied block by block
+		size_t nrTexels{};
+		for (MipLevel& level : m_MipLevels)
+		{
+			level.blocksPerRow = (level.width + BlockSize - 1) / BlockSize;
+			const int blocksPerColumn{ (level.height + BlockSize - 1) / BlockSize };
+			nrTexels += static_cast<size_t>(level.blocksPerRow) * blocksPerColumn * BlockSize * BlockSize;
+		}
+
+		TexelStorage tiledStorage(nrTexels);
+
+		size_t offset{};
+		for (MipLevel& level : m_MipLevels)
+		{
+			uint32_t* pTiled{ tiledStorage.data() + offset };
+			for (int y{}; y < level.height; ++y)
+			{
+				for (int x{}; x < level.width; ++x)
+				{
+					const int blockIndex{ (y / BlockSize) * level.blocksPerRow + x / BlockSize };
+					pTiled[blockIndex * BlockSize * BlockSize + (y % BlockSize) * BlockSize + x % BlockSize] = level.pTexels[x + y * level.width];
+				}
+			}
+
+			level.pTexels = pTiled;
+			const int blocksPerColumn{ (level.height + BlockSize - 1) / BlockSize };
+			offset += static_cast<size_t>(level.blocksPerRow) * blocksPerColumn * BlockSize * BlockSize;
+		}
+
+		m_TexelStorage = std::move(tiledStorage);
+		m_Layout = TexelLayout::Tiled;
+	}
+
+	Texture* Texture::LoadFromFile(const std::string& path, ID3D11Device* pDevice, TexelLayout layout)
+	{
+		const std::unique_ptr<MappedFile> pFile{ MappedFile::Open(path) };
+		assert(pFile && "Image failed to load.");
+		if (!pFile)
+			return nullptr;
+
+		return LoadFromFile(*pFile, pDevice, layout);
+	}
+
+	Texture* Texture::LoadFromFile(const MappedFile& file, ID3D11Device* pDevice, TexelLayout layout)
+	{
+		const std::string& path{ file.GetPath() };
+		if (HasExtension(path, ".tex"))
+		{
+			Texture* pMapped{ LoadMappedFromFile(path, pDevice) };
+			assert(pMapped && "Texture container failed to load.");
+			return pMapped;
+		}
+
+		//A bake at least as new as its source replaces decoding, unless it was baked with another layout
+		const std::string bakedPath{ GetBakedPath(path) };
+		if (IsBakeUpToDate(path, bakedPath))
+		{
+			if (Texture* pMapped{ LoadMappedFromFile(bakedPath, pDevice) })
+			{
+				if (pMapped->m_Format != TexelFormat::RGBA8 || pMapped->m_Layout == layout)
+					return pMapped;
+
+				delete pMapped;
+			}
+		}
+
+		if (HasExtension(path, ".dds"))
+			return LoadCompressedFromFile(file, pDevice);
+
+		return LoadImageFromFile(file, pDevice, layout);
+	}
+
+	bool Texture::Bake(const std::string& path, TexelLayout layout)
 	{
-		SDL_Surface* loadSurface = IMG_Load(path.c_str());
+		const std::unique_ptr<MappedFile> pFile{ MappedFile::Open(path) };
+		if (!pFile)
+			return false;
+
+		const std::unique_ptr<Texture> pTexture{ HasExtension(path, ".dds") ? LoadCompressedFromFile(*pFile, nullptr) : LoadImageFromFile(*pFile, nullptr, layout) };
+		return pTexture && pTexture->SaveToFile(GetBakedPath(path));
+	}
 
-		Texture* toReturn{ new Texture{ loadSurface } };
+	std::string Texture::GetBakedPath(const std::string& path)
+	{
+		return std::filesystem::path{ path }.replace_extension(".tex").string();
+	}
+
+	Texture* Texture::LoadImageFromFile(const MappedFile& file, ID3D11Device* pDevice, TexelLayout layout)
+	{
+		//Decoded straight from the mapping, SDL_image picks the format from the bytes as it does for a path
+		assert(file.GetSize() <= static_cast<size_t>(std::numeric_limits<int>::max()) && "Image file is too large.");
+		SDL_Surface* loadSurface = IMG_Load_RW(SDL_RWFromConstMem(file.GetData(), static_cast<int>(file.GetSize())), 1);
 
 		//if loadloadSurface == null throw assert
 		assert(loadSurface && "Image failed to load.");
 
-		DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		//Whatever the file stores, both paths get the same byte order
+		SDL_Surface* pConvertedSurface{ SDL_ConvertSurfaceFormat(loadSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+		SDL_FreeSurface(loadSurface);
+		assert(pConvertedSurface && "Image failed to convert.");
+
+		Texture* toReturn{ new Texture{ pConvertedSurface } };
+		SDL_FreeSurface(pConvertedSurface);
+
+		//Uploaded while still linear, only the software copy is rearranged
+		if (!toReturn->CreateShaderResource(pDevice))
+		{
+			delete toReturn;
+			return nullptr;
+		}
+
+		if (layout == TexelLayout::Tiled)
+		{
+			toReturn->ConvertToTiled();
+		}
+
+		return toReturn;
+	}
+
+	Texture* Texture::LoadCompressedFromFile(const MappedFile& file, ID3D11Device* pDevice)
+	{
+		const uint8_t* pBytes{ file.GetData() };
+		const size_t nrBytes{ file.GetSize() };
+
+		constexpr size_t magicSize{ sizeof(uint32_t) };
+		if (nrBytes < magicSize + sizeof(DdsHeader) || ReadUint32(pBytes) != MakeFourCC('D', 'D', 'S', ' '))
+		{
+			assert(false && "Not a DDS file.");
+			return nullptr;
+		}
+
+		DdsHeader header{};
+		std::copy_n(pBytes + magicSize, sizeof(DdsHeader), reinterpret_cast<uint8_t*>(&header));
+
+		//D3D rejects block compressed top levels that are not whole blocks
+		if (header.width == 0 || header.height == 0
+			|| header.width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION || header.height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION
+			|| header.width % BlockSize != 0 || header.height % BlockSize != 0
+			|| header.mipMapCount > static_cast<uint32_t>(GetFullChainLength(header.width, header.height)))
+		{
+			assert(false && "DDS size is not supported.");
+			return nullptr;
+		}
+
+		if ((header.pixelFormatFlags & DdsPixelFormatFourCC) == 0)
+		{
+			assert(false && "Only block compressed DDS files are supported.");
+			return nullptr;
+		}
+
+		size_t dataOffset{ magicSize + sizeof(DdsHeader) };
+		uint32_t dxgiFormat{};
+		if (header.fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			if (nrBytes < dataOffset + DdsDx10HeaderSize)
+				return nullptr;
+			dxgiFormat = ReadUint32(pBytes + dataOffset);
+			dataOffset += DdsDx10HeaderSize;
+		}
+
+		TexelFormat format{};
+		if (!ToTexelFormat(header.fourCC, dxgiFormat, format))
+		{
+			assert(false && "Only UNORM BC1, BC3 and BC5 DDS files are supported.");
+			return nullptr;
+		}
+
+		//Levels the file does not have are not generated, sampling clamps to the smallest one present
+		const int width{ static_cast<int>(header.width) };
+		const int height{ static_cast<int>(header.height) };
+		const int blockBytes{ format == TexelFormat::BC1 ? 8 : 16 };
+		const int nrMipLevels{ std::max(static_cast<int>(header.mipMapCount), 1) };
+		size_t dataSize{};
+		for (int i{}, levelWidth{ width }, levelHeight{ height }; i < nrMipLevels; ++i)
+		{
+			dataSize += static_cast<size_t>((levelWidth + BlockSize - 1) / BlockSize) * ((levelHeight + BlockSize - 1) / BlockSize) * blockBytes;
+			levelWidth = std::max(levelWidth / 2, 1);
+			levelHeight = std::max(levelHeight / 2, 1);
+		}
+
+		if (nrBytes < dataOffset + dataSize)
+		{
+			assert(false && "DDS file is truncated.");
+			return nullptr;
+		}
+
+		std::vector<uint8_t> blocks(pBytes + dataOffset, pBytes + dataOffset + dataSize);
+		Texture* toReturn{ new Texture{ format, width, height, nrMipLevels, std::move(blocks) } };
+
+		//The GPU gets the same blocks, no decode on either side
+		if (!toReturn->CreateShaderResource(pDevice))
+		{
+			delete toReturn;
+			return nullptr;
+		}
+
+		return toReturn;
+	}
+
+	Texture* Texture::LoadMappedFromFile(const std::string& path, ID3D11Device* pDevice)
+	{
+		std::unique_ptr<MappedFile> pMappedFile{ MappedFile::Open(path) };
+		if (!pMappedFile || pMappedFile->GetSize() < sizeof(ContainerHeader))
+			return nullptr;
+
+		ContainerHeader header{};
+		std::copy_n(pMappedFile->GetData(), sizeof(ContainerHeader), reinterpret_cast<uint8_t*>(&header));
+
+		if (header.magic != ContainerMagic || header.version != ContainerVersion
+			|| header.width == 0 || header.height == 0
+			|| header.width > static_cast<uint32_t>(std::numeric_limits<int>::max()) || header.height > static_cast<uint32_t>(std::numeric_limits<int>::max())
+			|| header.nrMipLevels == 0 || header.nrMipLevels > MaxContainerMipLevels
+			|| header.nrMipLevels > static_cast<uint32_t>(GetFullChainLength(header.width, header.height))
+			|| header.format > static_cast<uint32_t>(TexelFormat::BC5) || header.layout > static_cast<uint32_t>(TexelLayout::Tiled))
+			return nullptr;
+
+		Texture* toReturn{ new Texture{} };
+		toReturn->m_Format = static_cast<TexelFormat>(header.format);
+		toReturn->m_Layout = static_cast<TexelLayout>(header.layout);
+		toReturn->m_BlockBytes = toReturn->m_Format == TexelFormat::BC1 ? 8 : 16;
+		toReturn->m_CacheId = g_NextCacheId++;
+
+		int width{ static_cast<int>(header.width) };
+		int height{ static_cast<int>(header.height) };
+		for (uint32_t i{}; i < header.nrMipLevels; ++i)
+		{
+			MipLevel level{ nullptr, width, height, IsPowerOfTwo(width) && IsPowerOfTwo(height), width - 1, height - 1 };
+			level.blocksPerRow = (width + BlockSize - 1) / BlockSize;
+
+			//Anything that does not match the sizes this build would have written is rejected before it is read
+			const uint64_t offset{ header.mipOffsets[i] };
+			if (offset % ContainerAlignment != 0 || header.mipSizes[i] != toReturn->GetLevelSize(level)
+				|| offset > pMappedFile->GetSize() || header.mipSizes[i] > pMappedFile->GetSize() - offset)
+			{
+				delete toReturn;
+				return nullptr;
+			}
+
+			toReturn->SetLevelData(level, pMappedFile->GetData() + offset);
+
+			toReturn->m_MipLevels.push_back(level);
+
+			width = std::max(width / 2, 1);
+			height = std::max(height / 2, 1);
+		}
+
+		toReturn->m_pMappedFile = std::move(pMappedFile);
+
+		if (!toReturn->CreateShaderResource(pDevice))
+		{
+			delete toReturn;
+			return nullptr;
+		}
+
+		return toReturn;
+	}
+
+	bool Texture::SaveToFile(const std::string& path) const
+	{
+		if (m_MipLevels.size() > MaxContainerMipLevels)
+			return false;
+
+		ContainerHeader header{ ContainerMagic, ContainerVersion, static_cast<uint32_t>(m_Format), static_cast<uint32_t>(m_Layout),
+			static_cast<uint32_t>(GetWidth()), static_cast<uint32_t>(GetHeight()), static_cast<uint32_t>(m_MipLevels.size()) };
+
+		size_t offset{ AlignUp(sizeof(ContainerHeader), ContainerAlignment) };
+		for (size_t i{}; i < m_MipLevels.size(); ++i)
+		{
+			header.mipOffsets[i] = offset;
+			header.mipSizes[i] = GetLevelSize(m_MipLevels[i]);
+			offset = AlignUp(offset + header.mipSizes[i], ContainerAlignment);
+		}
+
+		std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+		if (!file)
+			return false;
+
+		const auto writePadding = [&file](size_t targetOffset)
+		{
+			static constexpr char padding[ContainerAlignment]{};
+			file.write(padding, static_cast<std::streamsize>(targetOffset - static_cast<size_t>(file.tellp())));
+		};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ContainerHeader));
+		for (size_t i{}; i < m_MipLevels.size(); ++i)
+		{
+			writePadding(header.mipOffsets[i]);
+			file.write(reinterpret_cast<const char*>(GetLevelData(m_MipLevels[i])), static_cast<std::streamsize>(header.mipSizes[i]));
+		}
+
+		return static_cast<bool>(file);
+	}
+
+	size_t Texture::GetLevelSize(const MipLevel& level) const
+	{
+		const size_t nrBlocks{ static_cast<size_t>((level.width + BlockSize - 1) / BlockSize) * ((level.height + BlockSize - 1) / BlockSize) };
+		if (m_Format != TexelFormat::RGBA8)
+			return nrBlocks * m_BlockBytes;
+
+		if (m_Layout == TexelLayout::Tiled)
+			return nrBlocks * BlockSize * BlockSize * sizeof(uint32_t);
+
+		return static_cast<size_t>(level.width) * level.height * sizeof(uint32_t);
+	}
+
+	const uint8_t* Texture::GetLevelData(const MipLevel& level) const
+	{
+		return m_Format == TexelFormat::RGBA8 ? reinterpret_cast<const uint8_t*>(level.pTexels) : level.pBlocks;
+	}
+
+	void Texture::SetLevelData(MipLevel& level, const uint8_t* pData) const
+	{
+		if (m_Format == TexelFormat::RGBA8)
+			level.pTexels = reinterpret_cast<const uint32_t*>(pData);
+		else
+			level.pBlocks = pData;
+	}
+
+	size_t Texture::GetResidentBytes() const
+	{
+		size_t nrBytes{};
+		for (size_t i{ static_cast<size_t>(m_FirstResidentLevel) }; i < m_MipLevels.size(); ++i)
+		{
+			nrBytes += GetLevelSize(m_MipLevels[i]);
+		}
+		return nrBytes;
+	}
+
+#pragma region Streaming
+	bool Texture::StartStreaming(size_t tailBytes)
+	{
+		if (!m_pMappedFile || m_pStreaming)
+			return false;
+
+		m_pStreaming = std::make_unique<StreamingState>();
+		m_pStreaming->path = m_pMappedFile->GetPath();
+		m_pStreaming->levelStorage.resize(m_MipLevels.size());
+
+		//The tail is copied out of the mapping, everything finer is dropped until the sampler asks for it
+		const int nrLevels{ static_cast<int>(m_MipLevels.size()) };
+		m_pStreaming->firstTailLevel = nrLevels - 1;
+		for (int i{}; i < nrLevels; ++i)
+		{
+			MipLevel& level{ m_MipLevels[i] };
+			const uint8_t* pData{ GetLevelData(level) };
+			m_pStreaming->levelOffsets.push_back(static_cast<uint64_t>(pData - m_pMappedFile->GetData()));
+
+			const size_t levelSize{ GetLevelSize(level) };
+			if (levelSize <= tailBytes)
+			{
+				m_pStreaming->firstTailLevel = std::min(m_pStreaming->firstTailLevel, i);
+			}
+
+			if (i < m_pStreaming->firstTailLevel)
+			{
+				SetLevelData(level, nullptr);
+				continue;
+			}
+
+			LevelStorage& storage{ m_pStreaming->levelStorage[i] };
+			storage.assign(pData, pData + levelSize);
+			SetLevelData(level, storage.data());
+		}
+
+		m_FirstResidentLevel = m_pStreaming->firstTailLevel;
+		m_pMappedFile.reset();
+		m_CacheId = g_NextCacheId++;
+		return true;
+	}
+
+	bool Texture::ReadLevel(const std::string& path, uint64_t offset, LevelStorage& storage)
+	{
+		std::ifstream file{ path, std::ios::binary };
+		file.seekg(static_cast<std::streamoff>(offset));
+		file.read(reinterpret_cast<char*>(storage.data()), static_cast<std::streamsize>(storage.size()));
+		return static_cast<bool>(file);
+	}
+
+	bool Texture::StreamInLevel(int levelIndex, LevelStorage&& storage)
+	{
+		if (!m_pStreaming || levelIndex != m_FirstResidentLevel - 1)
+			return false;
+
+		MipLevel& level{ m_MipLevels[levelIndex] };
+		if (storage.size() != GetLevelSize(level))
+			return false;
+
+		//Moving keeps the buffer, the read bytes are used in place
+		m_pStreaming->levelStorage[levelIndex] = std::move(storage);
+		SetLevelData(level, m_pStreaming->levelStorage[levelIndex].data());
+		m_FirstResidentLevel = levelIndex;
+		return true;
+	}
+
+	bool Texture::EvictLevel()
+	{
+		if (!m_pStreaming || m_FirstResidentLevel >= m_pStreaming->firstTailLevel)
+			return false;
+
+		SetLevelData(m_MipLevels[m_FirstResidentLevel], nullptr);
+		LevelStorage{}.swap(m_pStreaming->levelStorage[m_FirstResidentLevel]);
+		++m_FirstResidentLevel;
+
+		//A later level may be allocated where this one was, its decoded blocks must not be found again
+		m_CacheId = g_NextCacheId++;
+		return true;
+	}
+
+	int Texture::TakeRequestedLevel()
+	{
+		return m_RequestedLevel.exchange(NoRequestedLevel, std::memory_order_relaxed);
+	}
+
+	void Texture::RequestLevel(float lod) const
+	{
+		if (!m_pStreaming)
+			return;
+
+		//Only a finer level than already requested writes, the rest of the frame just reads
+		const int level{ static_cast<int>(lod) };
+		int requested{ m_RequestedLevel.load(std::memory_order_relaxed) };
+		while (level < requested && !m_RequestedLevel.compare_exchange_weak(requested, level, std::memory_order_relaxed))
+		{
+		}
+	}
+#pragma endregion
+
+	bool Texture::CreateShaderResource(ID3D11Device* pDevice)
+	{
+		if (!pDevice)
+			return true;
+
+		const DXGI_FORMAT format{ ToDxgiFormat(m_Format) };
+
+		std::vector<D3D11_SUBRESOURCE_DATA> initData(m_MipLevels.size());
+		std::vector<std::vector<uint32_t>> untiledLevels{};
+		untiledLevels.reserve(m_MipLevels.size());
+		for (size_t i{}; i < initData.size(); ++i)
+		{
+			const MipLevel& level{ m_MipLevels[i] };
+			const int blocksPerColumn{ (level.height + BlockSize - 1) / BlockSize };
+
+			if (m_Format != TexelFormat::RGBA8)
+			{
+				initData[i].pSysMem = level.pBlocks;
+				initData[i].SysMemPitch = static_cast<UINT>(level.blocksPerRow * m_BlockBytes);
+				initData[i].SysMemSlicePitch = static_cast<UINT>(level.blocksPerRow * blocksPerColumn * m_BlockBytes);
+				continue;
+			}
+
+			const uint32_t* pTexels{ level.pTexels };
+			if (m_Layout == TexelLayout::Tiled)
+			{
+				std::vector<uint32_t>& untiled{ untiledLevels.emplace_back(static_cast<size_t>(level.width) * level.height) };
+				for (int y{}; y < level.height; ++y)
+				{
+					for (int x{}; x < level.width; ++x)
+					{
+						untiled[x + y * level.width] = FetchTexel(level, x, y);
+					}
+				}
+				pTexels = untiled.data();
+			}
+
+			initData[i].pSysMem = pTexels;
+			initData[i].SysMemPitch = static_cast<UINT>(level.width * sizeof(uint32_t));
+			initData[i].SysMemSlicePitch = static_cast<UINT>(level.width * level.height * sizeof(uint32_t));
+		}
+
+		const UINT nrMipLevels{ static_cast<UINT>(initData.size()) };
+
 		D3D11_TEXTURE2D_DESC desc{};
-		desc.Width = loadSurface->w;
-		desc.Height = loadSurface->h;
-		desc.MipLevels = 1;
+		desc.Width = GetWidth();
+		desc.Height = GetHeight();
+		desc.MipLevels = nrMipLevels;
 		desc.ArraySize = 1;
 		desc.Format = format;
 		desc.SampleDesc.Count = 1;
@@ -53,52 +920,171 @@ namespace dae
 		desc.CPUAccessFlags = 0;
 		desc.MiscFlags = 0;
 
-
-		D3D11_SUBRESOURCE_DATA initData;
-		initData.pSysMem = loadSurface->pixels;
-		initData.SysMemPitch = static_cast<UINT>(loadSurface->pitch);
-		initData.SysMemSlicePitch = static_cast<UINT>(loadSurface->pitch * loadSurface->h);
-
-		HRESULT result = pDevice->CreateTexture2D(&desc, &initData, &toReturn->m_pShaderResource);
+		HRESULT result = pDevice->CreateTexture2D(&desc, initData.data(), &m_pShaderResource);
 
 		if (FAILED(result))
-		{
-			delete toReturn;
-			return nullptr;
-		}
-		
+			return false;
+
 		D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc{};
 		SRVDesc.Format = format;
 		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		SRVDesc.Texture2D.MipLevels = 1;
-		
-		result = pDevice->CreateShaderResourceView(toReturn->m_pShaderResource, &SRVDesc, &toReturn->m_pShaderResourceView);
-		if (FAILED(result))
+		SRVDesc.Texture2D.MipLevels = nrMipLevels;
+
+		result = pDevice->CreateShaderResourceView(m_pShaderResource, &SRVDesc, &m_pShaderResourceView);
+		return SUCCEEDED(result);
+	}
+
+	uint32_t Texture::FetchTexel(const MipLevel& level, int x, int y) const
+	{
+		//Wraps instead of reading outside the texture for uvs outside [0, 1]
+		if (level.isPowerOfTwo)
 		{
-			delete toReturn;
-			return nullptr;
+			x &= level.widthMask;
+			y &= level.heightMask;
+		}
+		else
+		{
+			x = ((x % level.width) + level.width) % level.width;
+			y = ((y % level.height) + level.height) % level.height;
 		}
 
-		return toReturn;
+		if (m_Format != TexelFormat::RGBA8)
+			return FetchCompressedTexel(level, x, y);
+
+		if (m_Layout == TexelLayout::Tiled)
+		{
+			//Block first, then the texel within its 4x4 block
+			const int blockIndex{ (y >> 2) * level.blocksPerRow + (x >> 2) };
+			return level.pTexels[(blockIndex << 4) + ((y & 3) << 2) + (x & 3)];
+		}
+
+		return level.pTexels[x + y * level.width];
+	}
+
+	uint32_t Texture::FetchCompressedTexel(const MipLevel& level, int x, int y) const
+	{
+		const int blockIndex{ (y >> 2) * level.blocksPerRow + (x >> 2) };
+		const uint8_t* pBlock{ level.pBlocks + static_cast<size_t>(blockIndex) * m_BlockBytes };
+
+		//Neighbouring blocks land in neighbouring slots, so a bilinear footprint never evicts itself
+		DecodedBlock& decoded{ g_DecodedBlocks[(reinterpret_cast<uintptr_t>(pBlock) / m_BlockBytes) & (NrDecodedBlocks - 1)] };
+		if (decoded.pBlock != pBlock || decoded.cacheId != m_CacheId)
+		{
+			DecodeBlock(m_Format, pBlock, decoded.texels);
+			decoded.pBlock = pBlock;
+			decoded.cacheId = m_CacheId;
+		}
+
+		return decoded.texels[((y & 3) << 2) + (x & 3)];
+	}
+
+	ColorRGB Texture::FetchColor(const MipLevel& level, int x, int y) const
+	{
+		return DecodeTexel(FetchTexel(level, x, y));
+	}
+
+	ColorRGB Texture::SamplePoint(const MipLevel& level, const Vector2& uv) const
+	{
+		return TextureFilter::SamplePoint(level, uv, [this](const MipLevel& level, int x, int y) { return FetchColor(level, x, y); });
 	}
 
 	ColorRGB Texture::Sample(const Vector2& uv) const
 	{
-		Uint32 x{ Uint32(uv.x * m_pSurface->w) }, y{ Uint32(uv.y * m_pSurface->h) };
-		uint8_t r, g, b;
+		//No derivatives to pick a level from, so the full resolution is wanted
+		RequestLevel(0.f);
+		return SamplePoint(m_MipLevels[m_FirstResidentLevel], uv);
+	}
+
+#pragma region Batch Sampling
+	void Texture::Sample4(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB) const
+	{
+		SampleLanes(pU, pV, pOutR, pOutG, pOutB, 4);
+	}
+
+	void Texture::Sample8(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB) const
+	{
+		SampleLanes(pU, pV, pOutR, pOutG, pOutB, 8);
+	}
+
+	void Texture::SampleLanes(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB, int nrLanes) const
+	{
+		RequestLevel(0.f);
+		const MipLevel& level{ m_MipLevels[m_FirstResidentLevel] };
+
+#if defined(__AVX2__)
+		//Block compressed texels have no address to gather from
+		if (m_Format == TexelFormat::RGBA8)
+		{
+			//Lanes past nrLanes are never loaded, gathered or stored, so 4 lanes run the same kernel as 8
+			const __m256i laneMask{ _mm256_cmpgt_epi32(_mm256_set1_epi32(nrLanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)) };
+
+			__m256i x{ _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(_mm256_maskload_ps(pU, laneMask), _mm256_set1_ps(static_cast<float>(level.width))))) };
+			__m256i y{ _mm256_cvttps_epi32(_mm256_floor_ps(_mm256_mul_ps(_mm256_maskload_ps(pV, laneMask), _mm256_set1_ps(static_cast<float>(level.height))))) };
 
-		SDL_GetRGB(m_pSurfacePixels[static_cast<uint32_t>(x + (y * m_pSurface->w))],
-			m_pSurface->format,
-			&r,
-			&g,
-			&b);
+			//Same wrap as FetchTexel, the modulo is done in float which is exact for any realistic uv
+			if (level.isPowerOfTwo)
+			{
+				x = _mm256_and_si256(x, _mm256_set1_epi32(level.widthMask));
+				y = _mm256_and_si256(y, _mm256_set1_epi32(level.heightMask));
+			}
+			else
+			{
+				const auto wrap = [](__m256i value, int size)
+				{
+					const __m256 quotient{ _mm256_floor_ps(_mm256_div_ps(_mm256_cvtepi32_ps(value), _mm256_set1_ps(static_cast<float>(size)))) };
+					return _mm256_sub_epi32(value, _mm256_mullo_epi32(_mm256_cvttps_epi32(quotient), _mm256_set1_epi32(size)));
+				};
+				x = wrap(x, level.width);
+				y = wrap(y, level.height);
+			}
 
-		ColorRGB pixelColor{ r / 255.f, g / 255.f, b / 255.f };
-		return pixelColor;
+			__m256i index{};
+			if (m_Layout == TexelLayout::Tiled)
+			{
+				const __m256i three{ _mm256_set1_epi32(3) };
+				const __m256i blockIndex{ _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, 2), _mm256_set1_epi32(level.blocksPerRow)), _mm256_srli_epi32(x, 2)) };
+				index = _mm256_add_epi32(_mm256_slli_epi32(blockIndex, 4), _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, three), 2), _mm256_and_si256(x, three)));
+			}
+			else
+			{
+				index = _mm256_add_epi32(x, _mm256_mullo_epi32(y, _mm256_set1_epi32(level.width)));
+			}
 
-		return {};
+			const __m256i texels{ _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(level.pTexels), index, laneMask, 4) };
+
+			const __m256i byteMask{ _mm256_set1_epi32(0xFF) };
+			const __m256 toFloat{ _mm256_set1_ps(ToFloat) };
+			_mm256_maskstore_ps(pOutR, laneMask, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, byteMask)), toFloat));
+			_mm256_maskstore_ps(pOutG, laneMask, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), byteMask)), toFloat));
+			_mm256_maskstore_ps(pOutB, laneMask, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), byteMask)), toFloat));
+			return;
+		}
+#endif
+
+		for (int i{}; i < nrLanes; ++i)
+		{
+			const ColorRGB color{ SamplePoint(level, Vector2{ pU[i], pV[i] }) };
+			pOutR[i] = color.r;
+			pOutG[i] = color.g;
+			pOutB[i] = color.b;
+		}
 	}
+#pragma endregion
 
+	float Texture::SampleAlpha(const Vector2& uv) const
+	{
+		RequestLevel(0.f);
+		const MipLevel& level{ m_MipLevels[m_FirstResidentLevel] };
+		return (FetchTexel(level, static_cast<int>(std::floor(uv.x * level.width)), static_cast<int>(std::floor(uv.y * level.height))) >> 24) * ToFloat;
+	}
+
+	ColorRGB Texture::Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, SampleState sampleState) const
+	{
+		//Streamed textures note the level they wanted and make do with the finest one resident
+		return TextureFilter::Sample(m_MipLevels, m_FirstResidentLevel, uv, uvDdx, uvDdy, sampleState,
+			[this](const MipLevel& level, int x, int y) { return FetchColor(level, x, y); },
+			[this](float lod) { RequestLevel(lod); });
+	}
 
 	ID3D11ShaderResourceView* Texture::GetShaderResourceView() const
 	{
@@ -1,30 +1,185 @@
 #pragma once
 #include <SDL_surface.h>
 #include <string>
+#include <atomic>
+#include <limits>
 #include "ColorRGB.h"
+#include "AlignedAllocator.h"
 #include <d3d11.h>
 
 namespace dae
 {
 	struct Vector2;
+	class MappedFile;
+
+	//Filtering for both render paths, hardware maps it onto a sampler state
+	enum class SampleState
+	{
+		Point,
+		Bilinear,
+		Trilinear,
+		Anisotropic
+	};
+
+	//In memory order of the software texels, tiled keeps each 4x4 block in 64 contiguous bytes
+	enum class TexelLayout
+	{
+		Linear,
+		Tiled
+	};
+
+	//Software texel storage, block compressed formats stay compressed and are decoded per 4x4 block on fetch
+	enum class TexelFormat
+	{
+		RGBA8,
+		BC1,
+		BC3,
+		BC5
+	};
 
 	class Texture
 	{
 	public:
 		~Texture();
 
-		static Texture* LoadFromFile(const std::string& path, ID3D11Device* pDevice);
+		//.tex containers are mapped and used in place, and an image with an up to date .tex next to it loads that instead.
+		//.dds files with BC1, BC3 or BC5 data keep their blocks and ignore the layout, anything else is decoded by SDL_image.
+		//Without a device only the software copy is made
+		static Texture* LoadFromFile(const std::string& path, ID3D11Device* pDevice, TexelLayout layout = TexelLayout::Linear);
+		//Same for a file the caller already mapped, e.g. to hash it, the source is decoded from that mapping
+		static Texture* LoadFromFile(const MappedFile& file, ID3D11Device* pDevice, TexelLayout layout = TexelLayout::Linear);
+
+		//Offline step, decodes the image or .dds at path and writes its software copy as a .tex next to it
+		static bool Bake(const std::string& path, TexelLayout layout = TexelLayout::Tiled);
+		static std::string GetBakedPath(const std::string& path);
+
+		//Nearest texel of the finest resident level, a streamed texture is asked to bring in its full resolution one
 		ColorRGB Sample(const Vector2& uv) const;
+		float SampleAlpha(const Vector2& uv) const;
+
+		//Same as Sample(uv) for 4 or 8 lanes at once with SoA input and output, AVX2 gathers when built with /arch:AVX2
+		void Sample4(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB) const;
+		void Sample8(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB) const;
+
+		//Level of detail from the screen space uv derivatives of the pixel
+		ColorRGB Sample(const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy, SampleState sampleState) const;
 
 		ID3D11ShaderResourceView* GetShaderResourceView() const ;
 
+		int GetWidth() const { return m_MipLevels.front().width; };
+		int GetHeight() const { return m_MipLevels.front().height; };
+		int GetNrMipLevels() const { return static_cast<int>(m_MipLevels.size()); };
+		TexelLayout GetLayout() const { return m_Layout; };
+		TexelFormat GetFormat() const { return m_Format; };
+
+		//Streamed textures keep their coarse levels, the finer ones are read back from their .tex by a TextureStreamer.
+		//Only a texture mapped from a container can stream
+		bool IsStreamed() const { return m_pStreaming != nullptr; };
+		bool CanStream() const { return m_pMappedFile != nullptr || m_pStreaming != nullptr; };
+		int GetFirstResidentLevel() const { return m_FirstResidentLevel; };
+		size_t GetResidentBytes() const;
+
+		static constexpr int MaxAnisotropy{ 8 };
+
 	private:
+		friend class TextureStreamer;
+
+		Texture();
 		Texture(SDL_Surface* pSurface);
+		Texture(TexelFormat format, int width, int height, int nrMipLevels, std::vector<uint8_t>&& blocks);
+
+		static Texture* LoadImageFromFile(const MappedFile& file, ID3D11Device* pDevice, TexelLayout layout);
+		static Texture* LoadCompressedFromFile(const MappedFile& file, ID3D11Device* pDevice);
+		static Texture* LoadMappedFromFile(const std::string& path, ID3D11Device* pDevice);
+		bool SaveToFile(const std::string& path) const;
+
+		//Uploads the software mip chain, tiled texels are untiled into a temporary copy first
+		bool CreateShaderResource(ID3D11Device* pDevice);
 
-		SDL_Surface* m_pSurface{ nullptr };
 		ID3D11ShaderResourceView* m_pShaderResourceView{};
 		ID3D11Texture2D* m_pShaderResource{};
 
-		uint32_t* m_pSurfacePixels{ nullptr };
+		//Power of two sizes wrap with a mask, others fall back to a modulo
+		struct MipLevel
+		{
+			const uint32_t* pTexels{};
+			int width{};
+			int height{};
+			bool isPowerOfTwo{ false };
+			int widthMask{};
+			int heightMask{};
+
+			//Tiled layout and compressed formats, blocks are padded to a multiple of 4 texels
+			int blocksPerRow{};
+
+			//Compressed formats only
+			const uint8_t* pBlocks{};
+		};
+
+		static constexpr int BlockSize{ 4 };
+
+		//Cache line aligned so a tiled 4x4 block of 64 bytes never straddles two lines
+		using TexelStorage = std::vector<uint32_t, AlignedAllocator<uint32_t, CacheLineSize>>;
+		using LevelStorage = std::vector<uint8_t, AlignedAllocator<uint8_t, CacheLineSize>>;
+
+		//Every level decoded at load into one allocation, R in the lowest byte and A in the highest
+		TexelStorage m_TexelStorage{};
+		std::vector<MipLevel> m_MipLevels{};
+		TexelLayout m_Layout{ TexelLayout::Linear };
+
+		//Compressed formats keep the file's blocks for every level in one allocation
+		std::vector<uint8_t> m_BlockStorage{};
+		TexelFormat m_Format{ TexelFormat::RGBA8 };
+		int m_BlockBytes{};
+
+		//Tells textures apart in the decoded block cache, block addresses can be reused after a texture is deleted
+		uint32_t m_CacheId{};
+
+		//Set for .tex containers, the levels point straight into the mapping instead of either storage
+		std::unique_ptr<MappedFile> m_pMappedFile;
+
+		//Where the levels that are not resident are read back from, each resident one owns its bytes
+		struct StreamingState
+		{
+			std::string path{};
+			std::vector<uint64_t> levelOffsets{};
+			std::vector<LevelStorage> levelStorage{};
+			int firstTailLevel{};
+		};
+
+		static constexpr int NoRequestedLevel{ std::numeric_limits<int>::max() };
+
+		std::unique_ptr<StreamingState> m_pStreaming;
+		int m_FirstResidentLevel{};
+
+		//Finest level the sampler wanted since the streamer last looked, written from every sampling thread
+		mutable std::atomic<int> m_RequestedLevel{ NoRequestedLevel };
+
+		//Streaming only starts from a mapped container, the levels up to tailBytes in size stay resident for good
+		bool StartStreaming(size_t tailBytes);
+		bool EvictLevel();
+
+		//The read touches nothing but the file and runs on a worker, the swap happens between frames and fails
+		//when the level is no longer the one right above the resident ones, e.g. after an eviction
+		static bool ReadLevel(const std::string& path, uint64_t offset, LevelStorage& storage);
+		bool StreamInLevel(int levelIndex, LevelStorage&& storage);
+		int TakeRequestedLevel();
+		void RequestLevel(float lod) const;
+
+		void BuildMipChain();
+		void ConvertToTiled();
+
+		//Bytes of a level as stored, padded blocks included
+		size_t GetLevelSize(const MipLevel& level) const;
+		const uint8_t* GetLevelData(const MipLevel& level) const;
+		void SetLevelData(MipLevel& level, const uint8_t* pData) const;
+
+		uint32_t FetchTexel(const MipLevel& level, int x, int y) const;
+		uint32_t FetchCompressedTexel(const MipLevel& level, int x, int y) const;
+		ColorRGB FetchColor(const MipLevel& level, int x, int y) const;
+		ColorRGB SamplePoint(const MipLevel& level, const Vector2& uv) const;
+
+		//Sample4 and Sample8, up to 8 lanes
+		void SampleLanes(const float* pU, const float* pV, float* pOutR, float* pOutG, float* pOutB, int nrLanes) const;
 	};
 }
@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "TextureCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace dae
+{
+	std::shared_ptr<Texture> TextureCache::Load(const std::string& path, ID3D11Device* pDevice, TexelLayout layout)
+	{
+		const std::string pathKey{ MakePathKey(path, layout) };
+		{
+			const std::lock_guard lock{ m_Mutex };
+			if (std::shared_ptr<Texture> pTexture{ FindByPath(pathKey) })
+				return pTexture;
+		}
+
+		//One mapping serves the hash, the content check and the decode, all outside the lock
+		const std::unique_ptr<MappedFile> pFile{ MappedFile::Open(path) };
+		if (!pFile)
+			return nullptr;
+
+		const uint64_t contentKey{ HashFile(*pFile, layout) };
+		{
+			const std::lock_guard lock{ m_Mutex };
+			if (std::shared_ptr<Texture> pTexture{ FindByContent(contentKey, *pFile, layout) })
+			{
+				m_TexturesByPath[pathKey] = pTexture;
+				return pTexture;
+			}
+		}
+
+		std::shared_ptr<Texture> pLoaded{ Texture::LoadFromFile(*pFile, pDevice, layout) };
+		if (!pLoaded)
+			return nullptr;
+
+		//Another thread may have loaded the same content in the meantime, its copy wins
+		const std::lock_guard lock{ m_Mutex };
+		if (std::shared_ptr<Texture> pTexture{ FindByContent(contentKey, *pFile, layout) })
+		{
+			pLoaded = pTexture;
+		}
+		else if (m_TexturesByContent[contentKey].pTexture.expired())
+		{
+			//A colliding file keeps the slot while it is alive, this one is then only shared by path
+			m_TexturesByContent[contentKey] = { pLoaded, path, layout };
+		}
+
+		m_TexturesByPath[pathKey] = pLoaded;
+		RemoveExpired();
+		return pLoaded;
+	}
+
+	std::shared_ptr<Texture> TextureCache::FindByPath(const std::string& pathKey)
+	{
+		const auto it{ m_TexturesByPath.find(pathKey) };
+		if (it == m_TexturesByPath.end())
+			return nullptr;
+
+		std::shared_ptr<Texture> pTexture{ it->second.lock() };
+		if (!pTexture)
+		{
+			m_TexturesByPath.erase(it);
+		}
+		return pTexture;
+	}
+
+	std::shared_ptr<Texture> TextureCache::FindByContent(uint64_t contentKey, const MappedFile& file, TexelLayout layout)
+	{
+		const auto it{ m_TexturesByContent.find(contentKey) };
+		if (it == m_TexturesByContent.end())
+			return nullptr;
+
+		std::shared_ptr<Texture> pTexture{ it->second.pTexture.lock() };
+		if (!pTexture)
+		{
+			m_TexturesByContent.erase(it);
+			return nullptr;
+		}
+
+		//The hash only finds candidates, a collision must not hand out another file's texture
+		return it->second.layout == layout && HasSameContent(file, it->second.path) ? pTexture : nullptr;
+	}
+
+	void TextureCache::RemoveExpired()
+	{
+		std::erase_if(m_TexturesByPath, [](const auto& entry) { return entry.second.expired(); });
+		std::erase_if(m_TexturesByContent, [](const auto& entry) { return entry.second.pTexture.expired(); });
+	}
+
+	std::string TextureCache::MakePathKey(const std::string& path, TexelLayout layout)
+	{
+		std::error_code error{};
+		const std::filesystem::path canonicalPath{ std::filesystem::weakly_canonical(path, error) };
+		return (error ? path : canonicalPath.string()) + '|' + std::to_string(static_cast<int>(layout));
+	}
+
+	uint64_t TextureCache::HashFile(const MappedFile& file, TexelLayout layout)
+	{
+		//FNV-1a over the file, seeded with the layout since each layout is its own texture
+		constexpr uint64_t prime{ 1099511628211ull };
+		uint64_t hash{ 14695981039346656037ull };
+		hash = (hash ^ static_cast<uint64_t>(layout)) * prime;
+
+		const uint8_t* pData{ file.GetData() };
+		for (size_t i{}; i < file.GetSize(); ++i)
+		{
+			hash = (hash ^ pData[i]) * prime;
+		}
+
+		return hash;
+	}
+
+	bool TextureCache::HasSameContent(const MappedFile& file, const std::string& otherPath)
+	{
+		//Only runs on a hash hit, which is almost always a real copy, so the other file is mapped rather than kept around
+		const std::unique_ptr<MappedFile> pOther{ MappedFile::Open(otherPath) };
+		return pOther && pOther->GetSize() == file.GetSize()
+			&& std::equal(file.GetData(), file.GetData() + file.GetSize(), pOther->GetData());
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include "Texture.h"
+
+namespace dae
+{
+	//Hands out shared textures, the same file is decoded and uploaded once however many materials use it.
+	//Entries are weak, a texture is freed as soon as its last handle is released and its entries go on the next miss
+	class TextureCache final
+	{
+	public:
+		TextureCache() = default;
+		~TextureCache() = default;
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache(TextureCache&&) noexcept = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+		TextureCache& operator=(TextureCache&&) noexcept = delete;
+
+		//Safe to call from several threads, loads of different files run concurrently
+		std::shared_ptr<Texture> Load(const std::string& path, ID3D11Device* pDevice, TexelLayout layout = TexelLayout::Linear);
+
+	private:
+		//The file and layout the texture was decoded with, a hash hit is only shared once both match
+		struct ContentEntry
+		{
+			std::weak_ptr<Texture> pTexture{};
+			std::string path{};
+			TexelLayout layout{};
+		};
+
+		std::mutex m_Mutex{};
+
+		//Canonical path first, then the content hash catches copies of the same file under other names
+		std::unordered_map<std::string, std::weak_ptr<Texture>> m_TexturesByPath{};
+		std::unordered_map<uint64_t, ContentEntry> m_TexturesByContent{};
+
+		std::shared_ptr<Texture> FindByPath(const std::string& pathKey);
+		std::shared_ptr<Texture> FindByContent(uint64_t contentKey, const MappedFile& file, TexelLayout layout);
+		void RemoveExpired();
+
+		static std::string MakePathKey(const std::string& path, TexelLayout layout);
+		static uint64_t HashFile(const MappedFile& file, TexelLayout layout);
+		static bool HasSameContent(const MappedFile& file, const std::string& otherPath);
+	};
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Vector2.h"
+#include "Texture.h"
+
+namespace dae
+{
+	//Filtering shared by Texture and MaterialTexture. fetch(level, x, y) returns the decoded texel at any integer
+	//coordinates and does the wrapping, the decoded type needs a static Lerp, += and a division by a float
+	namespace TextureFilter
+	{
+		template<typename Level, typename Fetch>
+		auto SamplePoint(const Level& level, const Vector2& uv, const Fetch& fetch)
+		{
+			return fetch(level, static_cast<int>(std::floor(uv.x * level.width)), static_cast<int>(std::floor(uv.y * level.height)));
+		}
+
+		template<typename Level, typename Fetch>
+		auto SampleBilinear(const Level& level, const Vector2& uv, const Fetch& fetch)
+		{
+			using Value = decltype(fetch(level, 0, 0));
+
+			//Texel centers sit at half integers
+			const float x{ uv.x * level.width - 0.5f };
+			const float y{ uv.y * level.height - 0.5f };
+			const float floorX{ std::floor(x) };
+			const float floorY{ std::floor(y) };
+			const float fractionX{ x - floorX };
+			const float fractionY{ y - floorY };
+			const int x0{ static_cast<int>(floorX) };
+			const int y0{ static_cast<int>(floorY) };
+
+			const Value top{ Value::Lerp(fetch(level, x0, y0), fetch(level, x0 + 1, y0), fractionX) };
+			const Value bottom{ Value::Lerp(fetch(level, x0, y0 + 1), fetch(level, x0 + 1, y0 + 1), fractionX) };
+
+			return Value::Lerp(top, bottom, fractionY);
+		}
+
+		template<typename Level, typename Fetch>
+		auto SampleTrilinear(const std::vector<Level>& levels, const Vector2& uv, float lod, const Fetch& fetch)
+		{
+			const int lastLevel{ static_cast<int>(levels.size()) - 1 };
+			const int level0{ std::min(static_cast<int>(lod), lastLevel) };
+			const int level1{ std::min(level0 + 1, lastLevel) };
+			const float fraction{ lod - level0 };
+
+			const auto value0{ SampleBilinear(levels[level0], uv, fetch) };
+			if (level0 == level1 || fraction <= 0.f)
+				return value0;
+
+			return decltype(value0)::Lerp(value0, SampleBilinear(levels[level1], uv, fetch), fraction);
+		}
+
+		//Level of detail from the screen space uv derivatives. requestLevel is told the level the footprint wants,
+		//levels before firstLevel are not resident and the finest one that is stands in for them
+		template<typename Level, typename Fetch, typename RequestLevel>
+		auto Sample(const std::vector<Level>& levels, int firstLevel, const Vector2& uv, const Vector2& uvDdx, const Vector2& uvDdy,
+			SampleState sampleState, const Fetch& fetch, const RequestLevel& requestLevel)
+		{
+			using Value = decltype(fetch(levels.front(), 0, 0));
+
+			//Footprint of the pixel in texels of the full resolution level
+			const Level& topLevel{ levels.front() };
+			const Vector2 texelDdx{ uvDdx.x * topLevel.width, uvDdx.y * topLevel.height };
+			const Vector2 texelDdy{ uvDdy.x * topLevel.width, uvDdy.y * topLevel.height };
+			const float lengthX{ texelDdx.Magnitude() };
+			const float lengthY{ texelDdy.Magnitude() };
+
+			const float maxLod{ static_cast<float>(levels.size() - 1) };
+			const float minLod{ static_cast<float>(firstLevel) };
+			const auto toLod = [&requestLevel, maxLod, minLod](float footprint)
+			{
+				const float lod{ std::clamp(std::log2(std::max(footprint, 1e-8f)), 0.f, maxLod) };
+				requestLevel(lod);
+				return std::max(lod, minLod);
+			};
+
+			switch (sampleState)
+			{
+			case SampleState::Point:
+				return SamplePoint(levels[static_cast<int>(toLod(std::max(lengthX, lengthY)) + 0.5f)], uv, fetch);
+			case SampleState::Bilinear:
+				return SampleBilinear(levels[static_cast<int>(toLod(std::max(lengthX, lengthY)) + 0.5f)], uv, fetch);
+			case SampleState::Trilinear:
+				return SampleTrilinear(levels, uv, toLod(std::max(lengthX, lengthY)), fetch);
+			case SampleState::Anisotropic:
+			default:
+			{
+				//A few trilinear taps along the major axis, each with the footprint of the minor axis
+				const float majorLength{ std::max(lengthX, lengthY) };
+				const float minorLength{ std::max(std::min(lengthX, lengthY), 1e-8f) };
+				const int nrTaps{ std::clamp(static_cast<int>(std::ceil(majorLength / minorLength)), 1, Texture::MaxAnisotropy) };
+				if (nrTaps == 1)
+					return SampleTrilinear(levels, uv, toLod(majorLength), fetch);
+
+				const Vector2 majorAxis{ lengthX >= lengthY ? uvDdx : uvDdy };
+				const float lod{ toLod(majorLength / nrTaps) };
+
+				Value value{};
+				for (int tap{}; tap < nrTaps; ++tap)
+				{
+					const float offset{ (tap + 0.5f) / nrTaps - 0.5f };
+					value += SampleTrilinear(levels, uv + majorAxis * offset, lod, fetch);
+				}
+				return value / static_cast<float>(nrTaps);
+			}
+			}
+		}
+	}
+}
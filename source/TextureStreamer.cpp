@@ -0,0 +1,131 @@
+#include "pch.h"
+#include "TextureStreamer.h"
+
+namespace dae
+{
+	TextureStreamer::TextureStreamer(size_t budgetBytes, ThreadPool& threadPool)
+		: m_ThreadPool{ threadPool }
+		, m_BudgetBytes{ budgetBytes }
+	{
+	}
+
+	bool TextureStreamer::Register(const std::shared_ptr<Texture>& pTexture)
+	{
+		if (!pTexture || !pTexture->StartStreaming(TailBytes))
+			return false;
+
+		m_Entries.push_back({ pTexture, m_Frame, pTexture->GetFirstResidentLevel() });
+		return true;
+	}
+
+	void TextureStreamer::Update()
+	{
+		++m_Frame;
+
+		m_Entries.erase(std::remove_if(m_Entries.begin(), m_Entries.end(), [](const Entry& entry) { return entry.pTexture.expired(); }), m_Entries.end());
+
+		//Whatever was sampled since the last update counts as used this frame
+		m_ResidentBytes = 0;
+		std::vector<Entry*> leastRecentlyUsed{};
+		for (Entry& entry : m_Entries)
+		{
+			const std::shared_ptr<Texture> pTexture{ entry.pTexture.lock() };
+			const int requestedLevel{ pTexture->TakeRequestedLevel() };
+			if (requestedLevel != Texture::NoRequestedLevel)
+			{
+				entry.lastUsedFrame = m_Frame;
+				entry.wantedLevel = requestedLevel;
+			}
+
+			//No frame is sampling, finished reads can be swapped in
+			if (entry.pRead && entry.pRead->isDone.load(std::memory_order_acquire))
+			{
+				if (entry.pRead->isRead)
+				{
+					pTexture->StreamInLevel(entry.pRead->levelIndex, std::move(entry.pRead->storage));
+				}
+				entry.pRead.reset();
+			}
+
+			m_ResidentBytes += pTexture->GetResidentBytes();
+			if (entry.pRead)
+			{
+				m_ResidentBytes += entry.pRead->nrBytes;
+			}
+			leastRecentlyUsed.push_back(&entry);
+		}
+
+		std::stable_sort(leastRecentlyUsed.begin(), leastRecentlyUsed.end(), [](const Entry* pA, const Entry* pB)
+			{
+				return pA->lastUsedFrame < pB->lastUsedFrame;
+			});
+
+		//The budget may have shrunk since the last update
+		Evict(leastRecentlyUsed, m_BudgetBytes);
+
+		//Only what was sampled this frame streams in, one level per texture in flight so a single large texture does not starve the rest
+		size_t nrBytesRead{};
+		for (auto it{ leastRecentlyUsed.rbegin() }; it != leastRecentlyUsed.rend(); ++it)
+		{
+			Entry& entry{ **it };
+			const std::shared_ptr<Texture> pTexture{ entry.pTexture.lock() };
+			const int firstResidentLevel{ pTexture->GetFirstResidentLevel() };
+			if (entry.pRead || entry.lastUsedFrame != m_Frame || entry.wantedLevel >= firstResidentLevel)
+				continue;
+
+			const size_t levelBytes{ pTexture->GetLevelSize(pTexture->m_MipLevels[firstResidentLevel - 1]) };
+			if (levelBytes > m_BudgetBytes || nrBytesRead + levelBytes > MaxBytesPerUpdate)
+				continue;
+
+			if (m_ResidentBytes + levelBytes > m_BudgetBytes)
+			{
+				Evict(leastRecentlyUsed, m_BudgetBytes - levelBytes);
+				if (m_ResidentBytes + levelBytes > m_BudgetBytes)
+					continue;
+			}
+
+			StartRead(entry, *pTexture, levelBytes);
+			m_ResidentBytes += levelBytes;
+			nrBytesRead += levelBytes;
+		}
+	}
+
+	void TextureStreamer::StartRead(Entry& entry, const Texture& texture, size_t levelBytes)
+	{
+		const int levelIndex{ texture.GetFirstResidentLevel() - 1 };
+		entry.pRead = std::make_shared<LevelRead>();
+		entry.pRead->levelIndex = levelIndex;
+		entry.pRead->path = texture.m_pStreaming->path;
+		entry.pRead->offset = texture.m_pStreaming->levelOffsets[levelIndex];
+		entry.pRead->nrBytes = levelBytes;
+
+		//Allocated on the worker too, zeroing a large level is not free
+		m_ThreadPool.Enqueue([pRead{ entry.pRead }]()
+			{
+				pRead->storage.resize(pRead->nrBytes);
+				pRead->isRead = Texture::ReadLevel(pRead->path, pRead->offset, pRead->storage);
+				pRead->isDone.store(true, std::memory_order_release);
+			});
+	}
+
+	void TextureStreamer::Evict(const std::vector<Entry*>& leastRecentlyUsed, size_t targetBytes)
+	{
+		//Levels finer than a texture last asked for can go, textures not sampled this frame can go down to their tail
+		for (const Entry* pEntry : leastRecentlyUsed)
+		{
+			if (m_ResidentBytes <= targetBytes)
+				return;
+
+			const std::shared_ptr<Texture> pTexture{ pEntry->pTexture.lock() };
+			const int keepLevel{ pEntry->lastUsedFrame == m_Frame ? pEntry->wantedLevel : pTexture->GetNrMipLevels() };
+			while (m_ResidentBytes > targetBytes && pTexture->GetFirstResidentLevel() < keepLevel)
+			{
+				const size_t levelBytes{ pTexture->GetLevelSize(pTexture->m_MipLevels[pTexture->GetFirstResidentLevel()]) };
+				if (!pTexture->EvictLevel())
+					break;
+
+				m_ResidentBytes -= levelBytes;
+			}
+		}
+	}
+}
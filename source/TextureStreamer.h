@@ -0,0 +1,69 @@
+#pragma once
+#include "Texture.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	//Keeps the software mip levels of registered textures within a memory budget, finer levels are read in
+	//once the sampler asks for them and the least recently used ones are dropped to make room.
+	//The reads run on the thread pool, a level read during one frame is swapped in by the next update
+	class TextureStreamer final
+	{
+	public:
+		TextureStreamer(size_t budgetBytes, ThreadPool& threadPool);
+		~TextureStreamer() = default;
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer(TextureStreamer&&) noexcept = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(TextureStreamer&&) noexcept = delete;
+
+		//Only textures mapped from a .tex container can stream, anything else stays fully resident
+		bool Register(const std::shared_ptr<Texture>& pTexture);
+
+		//Between frames, never while a frame is sampling
+		void Update();
+
+		void SetBudget(size_t budgetBytes) { m_BudgetBytes = budgetBytes; };
+		size_t GetBudget() const { return m_BudgetBytes; };
+
+		//Levels still being read count too, their memory is already allocated
+		size_t GetResidentBytes() const { return m_ResidentBytes; };
+
+	private:
+		//Owned by the job as well, so an unregistered texture or a destroyed streamer never pulls the storage away mid read
+		struct LevelRead
+		{
+			int levelIndex{};
+			std::string path{};
+			uint64_t offset{};
+			size_t nrBytes{};
+			Texture::LevelStorage storage{};
+			bool isRead{ false };
+			std::atomic<bool> isDone{ false };
+		};
+
+		struct Entry
+		{
+			std::weak_ptr<Texture> pTexture{};
+			uint64_t lastUsedFrame{};
+			int wantedLevel{};
+			std::shared_ptr<LevelRead> pRead{};
+		};
+
+		//Levels this small are loaded at registration and never evicted
+		static constexpr size_t TailBytes{ 64 * 1024 };
+
+		//Caps the reads started by one update, so a camera cut does not queue the whole scene at once
+		static constexpr size_t MaxBytesPerUpdate{ 8 * 1024 * 1024 };
+
+		ThreadPool& m_ThreadPool;
+		std::vector<Entry> m_Entries{};
+		size_t m_BudgetBytes{};
+		size_t m_ResidentBytes{};
+		uint64_t m_Frame{};
+
+		void Evict(const std::vector<Entry*>& leastRecentlyUsed, size_t targetBytes);
+		void StartRead(Entry& entry, const Texture& texture, size_t levelBytes);
+	};
+}
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "ThreadPool.h"
+#include <atomic>
+
+namespace dae
+{
+	ThreadPool::ThreadPool(uint32_t nrThreads)
+	{
+		if (nrThreads == 0)
+		{
+			const uint32_t hardwareThreads{ std::thread::hardware_concurrency() };
+			nrThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_Workers.reserve(nrThreads);
+		for (uint32_t i{}; i < nrThreads; ++i)
+		{
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_Condition.notify_all();
+
+		for (auto& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Enqueue(std::function<void()> job)
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_Jobs.emplace(std::move(job));
+		}
+		m_Condition.notify_one();
+	}
+
+	void ThreadPool::ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& func)
+	{
+		if (count == 0)
+			return;
+
+		const size_t nrChunks{ (count + chunkSize - 1) / chunkSize };
+		if (nrChunks == 1 || m_Workers.empty())
+		{
+			func(0, count);
+			return;
+		}
+
+		std::atomic<size_t> nextChunk{ 0 };
+		const auto runChunks = [&]()
+		{
+			for (size_t chunk{ nextChunk++ }; chunk < nrChunks; chunk = nextChunk++)
+			{
+				const size_t begin{ chunk * chunkSize };
+				func(begin, std::min(begin + chunkSize, count));
+			}
+		};
+
+		std::mutex doneMutex{};
+		std::condition_variable doneCondition{};
+		size_t nrHelpersRunning{ std::min(m_Workers.size(), nrChunks - 1) };
+
+		const size_t nrHelpers{ nrHelpersRunning };
+		for (size_t i{}; i < nrHelpers; ++i)
+		{
+			Enqueue([&]()
+				{
+					runChunks();
+
+					//Notify while holding the lock, the waiting thread owns the condition variable
+					std::lock_guard<std::mutex> lock{ doneMutex };
+					--nrHelpersRunning;
+					doneCondition.notify_one();
+				});
+		}
+
+		runChunks();
+
+		std::unique_lock<std::mutex> lock{ doneMutex };
+		doneCondition.wait(lock, [&]() { return nrHelpersRunning == 0; });
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		while (true)
+		{
+			std::function<void()> job{};
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_Condition.wait(lock, [this]() { return m_IsStopping || !m_Jobs.empty(); });
+
+				if (m_IsStopping && m_Jobs.empty())
+					return;
+
+				job = std::move(m_Jobs.front());
+				m_Jobs.pop();
+			}
+
+			job();
+		}
+	}
+}
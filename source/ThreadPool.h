@@ -0,0 +1,40 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+
+namespace dae
+{
+	class ThreadPool final
+	{
+	public:
+		//0 threads picks one worker per hardware thread minus the calling thread
+		ThreadPool(uint32_t nrThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		void Enqueue(std::function<void()> job);
+
+		//Splits [0, count) in chunks and calls func(begin, end) for each of them on the workers,
+		//the calling thread helps out and only returns once every chunk is done
+		void ParallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& func);
+
+		uint32_t GetNrThreads() const { return static_cast<uint32_t>(m_Workers.size()); };
+
+	private:
+		std::vector<std::thread> m_Workers{};
+		std::queue<std::function<void()>> m_Jobs{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_Condition{};
+		bool m_IsStopping{ false };
+
+		void WorkerLoop();
+	};
+}
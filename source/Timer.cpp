@@ -6,6 +6,7 @@ namespace dae
 	Timer::Timer()
 	{
 		const uint64_t countsPerSecond = SDL_GetPerformanceFrequency();
+		m_CountsPerSecond = countsPerSecond;
 		m_SecondsPerCount = 1.0f / static_cast<float>(countsPerSecond);
 	}
 
@@ -61,6 +62,9 @@ namespace dae
 
 		m_TotalTime = static_cast<float>(m_CurrentTime - m_PausedTime - m_BaseTime) * m_SecondsPerCount;
 
+		//Cap the backlog so a long stall does not trigger a burst of simulation steps
+		m_Accumulator = std::min(m_Accumulator + m_ElapsedTime, m_MaxAccumulatedTime);
+
 		//FPS LOGIC
 		m_FPSTimer += m_ElapsedTime;
 		++m_FPSCount;
@@ -69,6 +73,8 @@ namespace dae
 			m_dFPS = static_cast<float>(m_FPSCount) / m_FPSTimer;
 			m_FPS = m_FPSCount;
 			m_FPSCount = 0;
+			m_MissedDeadlines = m_MissedDeadlineCount;
+			m_MissedDeadlineCount = 0;
 			m_FPSTimer = 0.0f;
 		}
 	}
@@ -83,4 +89,63 @@ namespace dae
 			m_IsStopped = true;
 		}
 	}
+
+	bool Timer::ConsumeFixedStep()
+	{
+		if (m_Accumulator < m_FixedTimeStep)
+			return false;
+
+		m_Accumulator -= m_FixedTimeStep;
+		return true;
+	}
+
+	void Timer::WaitForNextFrame()
+	{
+		if (!m_UseFrameLimiter || m_TargetFPS == 0)
+			return;
+
+		const uint64_t countsPerFrame = m_CountsPerSecond / m_TargetFPS;
+		uint64_t currentTime = SDL_GetPerformanceCounter();
+
+		if (m_FrameDeadline == 0)
+		{
+			m_FrameDeadline = currentTime + countsPerFrame;
+		}
+
+		//Missed the deadline, start over from now instead of rushing the next frames to catch up
+		if (currentTime >= m_FrameDeadline)
+		{
+			++m_MissedDeadlineCount;
+			m_FrameDeadline = currentTime + countsPerFrame;
+			return;
+		}
+
+		//Sleep for the bulk of the remaining time, SDL_Delay can oversleep so stop a margin short of the deadline
+		float remaining = static_cast<float>(m_FrameDeadline - currentTime) * m_SecondsPerCount;
+		while (remaining > m_SleepMargin)
+		{
+			const uint32_t sleepMs = static_cast<uint32_t>((remaining - m_SleepMargin) * 1000.f);
+			if (sleepMs == 0)
+				break;
+
+			SDL_Delay(sleepMs);
+
+			const uint64_t wakeTime = SDL_GetPerformanceCounter();
+			const float slept = static_cast<float>(wakeTime - currentTime) * m_SecondsPerCount;
+			const float oversleep = slept - static_cast<float>(sleepMs) / 1000.f;
+
+			//Grow the margin immediately on a bad oversleep, shrink it slowly when the scheduler behaves
+			m_SleepMargin = Clamp(std::max(oversleep, Lerpf(m_SleepMargin, oversleep, 0.05f)), 0.00025f, 0.004f);
+
+			currentTime = wakeTime;
+			remaining = currentTime < m_FrameDeadline ? static_cast<float>(m_FrameDeadline - currentTime) * m_SecondsPerCount : 0.f;
+		}
+
+		//Spin for the last part to hit the deadline precisely
+		while (SDL_GetPerformanceCounter() < m_FrameDeadline)
+		{
+		}
+
+		m_FrameDeadline += countsPerFrame;
+	}
 }
\ No newline at end of file
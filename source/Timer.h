@@ -42,6 +42,31 @@ namespace dae
 		};
 		bool DoPrintFps() { return m_PrintFps; };
 
+		//Frame limiter, a target of 0 runs unlimited
+		void SetTargetFPS(uint32_t targetFPS) { m_TargetFPS = targetFPS; m_FrameDeadline = 0; };
+		uint32_t GetTargetFPS() const { return m_TargetFPS; };
+		uint32_t GetMissedDeadlines() const { return m_MissedDeadlines; };
+		void ToggleFrameLimiter() {
+			m_UseFrameLimiter = !m_UseFrameLimiter;
+			m_FrameDeadline = 0;
+			switch (m_UseFrameLimiter)
+			{
+			case true:
+				std::cout << "Frame Limiter: ON (" << m_TargetFPS << " FPS)\n";
+				break;
+			case false:
+				std::cout << "Frame Limiter: OFF\n";
+				break;
+			}
+		};
+		void WaitForNextFrame();
+
+		//Fixed timestep simulation, consume steps until the accumulated time runs out then render with the leftover fraction
+		void SetFixedTimeStep(float fixedTimeStep) { m_FixedTimeStep = fixedTimeStep; m_Accumulator = 0.0f; };
+		float GetFixedTimeStep() const { return m_FixedTimeStep; };
+		bool ConsumeFixedStep();
+		float GetInterpolationAlpha() const { return m_Accumulator / m_FixedTimeStep; };
+
 	private:
 		uint64_t m_BaseTime = 0;
 		uint64_t m_PausedTime = 0;
@@ -63,5 +88,17 @@ namespace dae
 		bool m_ForceElapsedUpperBound = false;
 
 		bool m_PrintFps = false;
+
+		uint64_t m_CountsPerSecond = 0;
+		uint64_t m_FrameDeadline = 0;
+		uint32_t m_TargetFPS = 60;
+		uint32_t m_MissedDeadlines = 0;
+		uint32_t m_MissedDeadlineCount = 0;
+		float m_SleepMargin = 0.002f;
+		bool m_UseFrameLimiter = true;
+
+		float m_FixedTimeStep = 1.0f / 60.0f;
+		float m_Accumulator = 0.0f;
+		float m_MaxAccumulatedTime = 0.25f;
 	};
 }
\ No newline at end of file
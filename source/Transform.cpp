@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "Transform.h"
+
+namespace dae
+{
+	namespace
+	{
+		//Keeps accumulated angles small so repeated rotation does not lose precision
+		float WrapAngle(float angle)
+		{
+			angle = fmodf(angle + PI, PI_2);
+			if (angle < 0.f)
+				angle += PI_2;
+			return angle - PI;
+		}
+
+		bool AreEqual(const Vector3& a, const Vector3& b)
+		{
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	}
+
+	Transform::Transform(const Vector3& position, const Vector3& rotation, const Vector3& scale) :
+		m_Position{ position },
+		m_Rotation{ rotation },
+		m_Scale{ scale },
+		m_PreviousPosition{ position },
+		m_PreviousRotation{ rotation },
+		m_PreviousScale{ scale }
+	{
+	}
+
+	void Transform::SetPosition(const Vector3& position)
+	{
+		m_Position = position;
+		MarkDirty();
+	}
+
+	void Transform::SetRotation(const Vector3& rotation)
+	{
+		m_Rotation = { WrapAngle(rotation.x), WrapAngle(rotation.y), WrapAngle(rotation.z) };
+		MarkDirty();
+	}
+
+	void Transform::SetScale(const Vector3& scale)
+	{
+		m_Scale = scale;
+		MarkDirty();
+	}
+
+	void Transform::Translate(const Vector3& translation)
+	{
+		SetPosition(m_Position + translation);
+	}
+
+	void Transform::Rotate(const Vector3& rotation)
+	{
+		SetRotation(m_Rotation + rotation);
+	}
+
+	const Matrix& Transform::GetWorldMatrix() const
+	{
+		if (m_IsWorldDirty)
+		{
+			m_WorldMatrix = MakeMatrix(m_Position, m_Rotation, m_Scale);
+			m_IsWorldDirty = false;
+		}
+
+		return m_WorldMatrix;
+	}
+
+	void Transform::StorePreviousState()
+	{
+		m_PreviousPosition = m_Position;
+		m_PreviousRotation = m_Rotation;
+		m_PreviousScale = m_Scale;
+	}
+
+	void Transform::Interpolate(float alpha)
+	{
+		if (IsMoving())
+		{
+			//Shortest way around for angles that wrapped between the two updates
+			const Vector3 rotationDelta{
+				WrapAngle(m_Rotation.x - m_PreviousRotation.x),
+				WrapAngle(m_Rotation.y - m_PreviousRotation.y),
+				WrapAngle(m_Rotation.z - m_PreviousRotation.z) };
+
+			m_RenderMatrix = MakeMatrix(
+				m_PreviousPosition + (m_Position - m_PreviousPosition) * alpha,
+				m_PreviousRotation + rotationDelta * alpha,
+				m_PreviousScale + (m_Scale - m_PreviousScale) * alpha);
+
+			m_IsRenderInterpolated = true;
+			++m_RenderVersion;
+			return;
+		}
+
+		//At rest, the render matrix is the world matrix and only needs refreshing once
+		if (m_IsRenderInterpolated || m_RenderSourceVersion != m_Version)
+		{
+			m_RenderMatrix = GetWorldMatrix();
+			m_RenderSourceVersion = m_Version;
+			m_IsRenderInterpolated = false;
+			++m_RenderVersion;
+		}
+	}
+
+	void Transform::MarkDirty()
+	{
+		m_IsWorldDirty = true;
+		++m_Version;
+	}
+
+	bool Transform::IsMoving() const
+	{
+		return !AreEqual(m_Position, m_PreviousPosition) || !AreEqual(m_Rotation, m_PreviousRotation) || !AreEqual(m_Scale, m_PreviousScale);
+	}
+
+	Matrix Transform::MakeMatrix(const Vector3& position, const Vector3& rotation, const Vector3& scale)
+	{
+		return Matrix::CreateScale(scale) * Matrix::CreateRotation(rotation) * Matrix::CreateTranslation(position);
+	}
+}
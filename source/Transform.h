@@ -0,0 +1,58 @@
+#pragma once
+#include "Math.h"
+
+namespace dae
+{
+	//Position, euler rotation (radians) and scale with a lazily rebuilt world matrix.
+	//Keeps the state of the previous fixed update so rendering can interpolate between the two.
+	class Transform final
+	{
+	public:
+		Transform(const Vector3& position = Vector3::Zero, const Vector3& rotation = Vector3::Zero, const Vector3& scale = { 1.f, 1.f, 1.f });
+
+		const Vector3& GetPosition() const { return m_Position; };
+		const Vector3& GetRotation() const { return m_Rotation; };
+		const Vector3& GetScale() const { return m_Scale; };
+
+		void SetPosition(const Vector3& position);
+		void SetRotation(const Vector3& rotation);
+		void SetScale(const Vector3& scale);
+		void Translate(const Vector3& translation);
+		void Rotate(const Vector3& rotation);
+
+		//Only rebuilt when an input changed since the last call
+		const Matrix& GetWorldMatrix() const;
+
+		//Incremented on every change, lets dependent caches know they are stale
+		uint32_t GetVersion() const { return m_Version; };
+
+		void StorePreviousState();
+		void Interpolate(float alpha);
+
+		const Matrix& GetRenderMatrix() const { return m_RenderMatrix; };
+		uint32_t GetRenderVersion() const { return m_RenderVersion; };
+
+	private:
+		Vector3 m_Position{};
+		Vector3 m_Rotation{};
+		Vector3 m_Scale{ 1.f, 1.f, 1.f };
+
+		Vector3 m_PreviousPosition{};
+		Vector3 m_PreviousRotation{};
+		Vector3 m_PreviousScale{ 1.f, 1.f, 1.f };
+
+		mutable Matrix m_WorldMatrix{};
+		mutable bool m_IsWorldDirty{ true };
+		uint32_t m_Version{};
+
+		Matrix m_RenderMatrix{};
+		uint32_t m_RenderVersion{};
+		uint32_t m_RenderSourceVersion{ UINT32_MAX };
+		bool m_IsRenderInterpolated{ false };
+
+		void MarkDirty();
+		bool IsMoving() const;
+
+		static Matrix MakeMatrix(const Vector3& position, const Vector3& rotation, const Vector3& scale);
+	};
+}
@@ -118,6 +118,23 @@ namespace dae
 				file.ignore(1000, '\n');
 			}
 
+			for (auto& v : vertices)
+			{
+				if (flipAxisAndWinding)
+				{
+					v.position.z *= -1.f;
+					v.normal.z *= -1.f;
+				}
+
+			}
+
+			return true;
+		}
+
+		//Separate from parsing so it can run as its own startup task, on a flipped mesh it gives
+		//the same tangents as flipping them afterwards since swapping the winding cancels out
+		static void ComputeTangents(std::vector<Vertex_In>& vertices, const std::vector<uint32_t>& indices)
+		{
 			//Cheap Tangent Calculations
 			for (uint32_t i = 0; i < indices.size(); i += 3)
 			{
@@ -145,20 +162,10 @@ namespace dae
 			}
 
 			//Create the Tangents (reject)
-			for (auto& v : vertices)
-			{
-				//v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
-
-				if (flipAxisAndWinding)
-				{
-					v.position.z *= -1.f;
-					v.normal.z *= -1.f;
-					v.tangent.z *= -1.f;
-				}
-
-			}
-
-			return true;
+			//for (auto& v : vertices)
+			//{
+			//	v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+			//}
 		}
 #pragma warning(pop)
 
@@ -15,11 +15,38 @@ void ShutDown(SDL_Window* pWindow)
 	SDL_Quit();
 }
 
+//DirectX.exe --bake <images...> [--linear <images...>] writes a .tex container next to every image, tiled by default, paths after --linear are baked linear
+int BakeTextures(int argc, char* args[])
+{
+	TexelLayout layout{ TexelLayout::Tiled };
+	int nrFailed{};
+	for (int i{ 2 }; i < argc; ++i)
+	{
+		const std::string path{ args[i] };
+		if (path == "--linear")
+		{
+			layout = TexelLayout::Linear;
+			continue;
+		}
+
+		if (Texture::Bake(path, layout))
+		{
+			std::cout << "Baked " << path << " to " << Texture::GetBakedPath(path) << "\n";
+		}
+		else
+		{
+			std::cout << "Failed to bake " << path << "\n";
+			++nrFailed;
+		}
+	}
+
+	return nrFailed == 0 ? 0 : 1;
+}
+
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
+	if (argc > 1 && std::string{ args[1] } == "--bake")
+		return BakeTextures(argc, args);
 
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
@@ -38,8 +65,13 @@ int main(int argc, char* args[])
 
 	//Initialize "framework"
 	const auto pTimer = new Timer();
+	pTimer->SetTargetFPS(60);
+	pTimer->SetFixedTimeStep(1.f / 60.f);
 	const auto pRenderer = new Renderer(pWindow);
 
+	//Dynamic resolution aims for the frame limiter's target
+	pRenderer->SetFrameTimeBudget(1000.f / pTimer->GetTargetFPS());
+
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
@@ -80,18 +112,34 @@ int main(int argc, char* args[])
 					pRenderer->ToggleClearColor();
 				if (e.key.keysym.scancode == SDL_SCANCODE_F11)
 					pTimer->TogglePrintFps();
+				if (e.key.keysym.scancode == SDL_SCANCODE_F12)
+					pRenderer->ToggleDynamicResolution();
+				if (e.key.keysym.scancode == SDL_SCANCODE_1)
+					pRenderer->ToggleVariableRateShading();
+				if (e.key.keysym.scancode == SDL_SCANCODE_2)
+					pRenderer->ToggleCheckerboard();
+				if (e.key.keysym.scancode == SDL_SCANCODE_3)
+					pTimer->ToggleFrameLimiter();
+				if (e.key.keysym.scancode == SDL_SCANCODE_4)
+					pRenderer->ToggleInstancing();
+				if (e.key.keysym.scancode == SDL_SCANCODE_5)
+					pRenderer->ToggleTopDownView();
 				break;
 			default:;
 			}
 		}
 
 		//--------- Update ---------
-		pRenderer->Update(pTimer);
+		while (pTimer->ConsumeFixedStep())
+		{
+			pRenderer->Update(pTimer->GetFixedTimeStep());
+		}
 
 		//--------- Render ---------
-		pRenderer->Render();
+		pRenderer->Render(pTimer->GetInterpolationAlpha());
 
 		//--------- Timer ---------
+		pTimer->WaitForNextFrame();
 		pTimer->Update();
 		printTimer += pTimer->GetElapsed();
 		if (printTimer >= 1.f)
@@ -100,6 +148,10 @@ int main(int argc, char* args[])
 			if (pTimer->DoPrintFps())
 			{
 				std::cout << "dFPS: " << pTimer->GetdFPS() << std::endl;
+				if (pTimer->GetMissedDeadlines() > 0)
+				{
+					std::cout << "Missed frame deadlines: " << pTimer->GetMissedDeadlines() << std::endl;
+				}
 			}
 		}
 	}